@@ -0,0 +1,539 @@
+#include "benchmark.h"
+#include "vi_assert.h"
+#include "load.h"
+#include "physics.h"
+#include "jobs.h"
+#include "noise.h"
+#include "tick.h"
+#include "game/game.h"
+#include "game/team.h"
+#include "game/master.h"
+#include "game/entities.h"
+#include "game/minion.h"
+#include "game/walker.h"
+#include "game/debris.h"
+#include "data/ragdoll.h"
+#include "mersenne/mersenne-twister.h"
+#include "data/json.h"
+#include "cjson/cJSON.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+namespace VI
+{
+
+namespace Benchmark
+{
+
+typedef std::chrono::steady_clock Clock;
+
+#define BENCHMARK_MINION_INTERVAL 0.25f // simulated seconds between minion spawns at each spawn point
+#define BENCHMARK_RAGDOLLS 50
+#define BENCHMARK_GLASS_INTERVAL 1.0f // simulated seconds between shard bursts
+#define BENCHMARK_GLASS_SHARDS 12 // same as a shattered pane
+
+const char* system_names[s32(System::count)] =
+{
+	"loop",
+	"net",
+	"ai",
+	"team",
+	"physics",
+	"animation",
+	"walkers",
+	"bots",
+	"projectiles",
+	"minions",
+	"drones",
+	"other",
+};
+
+const char* scenario_names[s32(Scenario::count)] =
+{
+	"match",
+	"walkers",
+	"ragdolls",
+	"glass",
+};
+
+struct GlassSource
+{
+	Quat rot;
+	Vec3 pos;
+	Vec2 size;
+};
+
+struct State
+{
+	Config config;
+	Clock::time_point start;
+	Clock::time_point last;
+	Clock::time_point end;
+	u64 ns[s32(System::count)];
+	u64 allocations[s32(System::count)];
+	u64 allocations_last;
+	Array<r32> physics_steps; // every step the benchmark saw, in seconds
+	Array<GlassSource> glass;
+	r64 physics_substeps; // summed over every step
+	r64 physics_bodies_active;
+	r64 physics_contacts;
+	r64 physics_sync; // sync_static and sync_dynamic, summed over every tick
+	r64 time_start;
+	r64 minions; // summed over every tick
+	r64 debris_awake; // same
+	r32 minion_timer;
+	r32 glass_timer;
+	u32 physics_step_id;
+	u64 support_queries_start;
+	u64 support_cache_hits_start;
+	r64 raycast_batch_time_start;
+	u64 raycast_batch_rays_start;
+	u32 ticks;
+	b8 enabled;
+	std::atomic<b8> running; // read by the allocation hooks on every thread
+};
+State state;
+
+// every heap allocation made through operator new or Bullet while the benchmark is running.
+// arrays grow through malloc/realloc directly and aren't counted
+std::atomic<u64> allocations_total;
+thread_local u64 allocations_thread;
+
+inline void allocation_count()
+{
+	if (state.running.load(std::memory_order_relaxed))
+	{
+		allocations_total.fetch_add(1, std::memory_order_relaxed);
+		allocations_thread++;
+	}
+}
+
+void* bullet_alloc(size_t size)
+{
+	allocation_count();
+	return malloc(size);
+}
+
+void bullet_free(void* p)
+{
+	free(p);
+}
+
+u64 nanoseconds(Clock::duration d)
+{
+	return u64(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+}
+
+const char* scenario_string(Scenario s)
+{
+	vi_assert(s32(s) >= 0 && s < Scenario::count);
+	return scenario_names[s32(s)];
+}
+
+b8 active()
+{
+	return state.enabled;
+}
+
+void init(const Config& config)
+{
+	state.config = config;
+	state.enabled = true;
+	Physics::raycast_batch_per_ray = config.raycasts_per_ray;
+	btAlignedAllocSetCustom(bullet_alloc, bullet_free);
+}
+
+// kill minions until there are enough ragdolls.
+// the server normally leaves ragdolls to clients as ghosts, so simulate them here the way a client would
+void ragdolls_fill()
+{
+	s32 needed = BENCHMARK_RAGDOLLS - Ragdoll::list.count();
+	for (auto i = Minion::list.iterator(); !i.is_last() && needed > 0; i.next())
+	{
+		Health* health = i.item()->get<Health>();
+		if (health->hp > 0)
+		{
+			health->kill(nullptr);
+			needed--;
+		}
+	}
+
+	for (auto i = Ragdoll::list.iterator(); !i.is_last(); i.next())
+	{
+		for (s32 j = 0; j < i.item()->bodies.length; j++)
+		{
+			Transform* body = i.item()->bodies[j].body.ref();
+			if (body && (body->get<RigidBody>()->flags & RigidBody::FlagGhost))
+				body->get<RigidBody>()->set_ghost(false);
+		}
+	}
+}
+
+// shatter every pane, and remember where they were.
+// shards are cosmetic and never exist on the server, so bursts of debris stand in for them
+void glass_start()
+{
+	Array<Glass*> panes;
+	for (auto i = Glass::list.iterator(); !i.is_last(); i.next())
+		panes.add(i.item());
+
+	for (s32 i = 0; i < panes.length; i++)
+	{
+		GlassSource* g = state.glass.add();
+		panes[i]->get<Transform>()->absolute(&g->pos, &g->rot);
+		const Vec3& size = panes[i]->get<RigidBody>()->size;
+		g->size = Vec2(size.x, size.y);
+		panes[i]->shatter(g->pos, g->rot * Vec3(0, 0, 1));
+	}
+
+	if (state.glass.length == 0)
+	{
+		// no glass in this level; burst over the spawn points instead
+		for (auto i = SpawnPoint::list.iterator(); !i.is_last(); i.next())
+		{
+			GlassSource* g = state.glass.add();
+			i.item()->get<Transform>()->absolute(&g->pos, &g->rot);
+			g->pos.y += 3.0f;
+			g->size = Vec2(1.0f);
+		}
+	}
+}
+
+void glass_fill()
+{
+	state.glass_timer -= Game::time.delta;
+	if (state.glass_timer > 0.0f)
+		return;
+	state.glass_timer = BENCHMARK_GLASS_INTERVAL;
+
+	for (s32 i = 0; i < state.glass.length; i++)
+	{
+		const GlassSource& g = state.glass[i];
+		Vec3 normal = g.rot * Vec3(0, 0, 1);
+		for (s32 j = 0; j < BENCHMARK_GLASS_SHARDS; j++)
+		{
+			Debris::Def def;
+			def.pos = g.pos + g.rot * Vec3((mersenne::randf_cc() - 0.5f) * 2.0f * g.size.x, (mersenne::randf_cc() - 0.5f) * 2.0f * g.size.y, 0);
+			def.rot = g.rot;
+			def.velocity = normal * (1.0f + mersenne::randf_cc() * 2.0f);
+			def.angular_velocity = Vec3((mersenne::randf_cc() - 0.5f) * 4.0f, (mersenne::randf_cc() - 0.5f) * 4.0f, (mersenne::randf_cc() - 0.5f) * 4.0f);
+			def.radius = 0.025f;
+			def.restitution = 0.5f;
+			def.damping = 0.25f;
+			def.mask = CollisionStatic | CollisionElectric | CollisionParkour | CollisionInaccessible;
+			def.flat = true;
+			Debris::add(def);
+		}
+	}
+}
+
+void start()
+{
+	AssetID level = Loader::find_level(state.config.level);
+	if (level == AssetNull)
+	{
+		fprintf(stderr, "Level '%s' not found.\n", state.config.level);
+		Game::quit = true;
+		return;
+	}
+
+	mersenne::srand(state.config.seed);
+	noise::reseed();
+
+	Game::session.type = SessionType::Multiplayer;
+	Net::Master::ServerConfig* config = &Game::session.config;
+	config->id = 1; // 0 means story mode
+	config->game_type = state.config.game_type;
+	config->max_players = MAX_PLAYERS;
+	config->fill_bots = MAX_PLAYERS - 1; // every slot is a bot
+	config->time_limit_parkour_ready = 0; // straight into the match
+
+	Game::load_level(level, Game::Mode::Pvp);
+
+	if (state.config.scenario == Scenario::Ragdolls)
+		Ragdoll::limit = BENCHMARK_RAGDOLLS;
+	else if (state.config.scenario == Scenario::Glass)
+		glass_start();
+
+	vi_debug("Benchmark: %s, %s, %s, seed %u.", state.config.level, Net::Master::ServerConfig::game_type_string(state.config.game_type), scenario_string(state.config.scenario), state.config.seed);
+
+	state.time_start = Game::time.total;
+	state.physics_step_id = Physics::stats.last.id; // ignore the steps it took to load
+	state.support_queries_start = Walker::support_queries;
+	state.support_cache_hits_start = Walker::support_cache_hits;
+	state.raycast_batch_time_start = Physics::stats.raycast_batch_time;
+	state.raycast_batch_rays_start = Physics::stats.raycast_batch_rays;
+	state.start = Clock::now();
+	state.last = state.start;
+	state.running = true;
+}
+
+void lap(System s)
+{
+	if (!state.running)
+		return;
+
+	Clock::time_point now = Clock::now();
+	state.ns[s32(s)] += nanoseconds(now - state.last);
+	state.last = now;
+
+	state.allocations[s32(s)] += allocations_thread - state.allocations_last;
+	state.allocations_last = allocations_thread;
+}
+
+// spawn minions the same way minion spawners and spawn points do, just a lot more often
+void minions_fill()
+{
+	state.minion_timer -= Game::time.delta;
+	if (state.minion_timer > 0.0f || Team::match_state != Team::MatchState::Active)
+		return;
+	state.minion_timer = BENCHMARK_MINION_INTERVAL;
+
+	s32 count = Minion::list.count();
+	for (s32 i = 0; i < ParticleEffect::list.length; i++)
+	{
+		if (ParticleEffect::list[i].type == ParticleEffect::Type::SpawnMinion)
+			count++;
+	}
+
+	for (auto i = SpawnPoint::list.iterator(); !i.is_last() && count < MAX_MINIONS; i.next())
+	{
+		if (i.item()->team != AI::TeamNone)
+		{
+			Vec3 pos;
+			Quat rot;
+			i.item()->get<Transform>()->absolute(&pos, &rot);
+			pos += rot * Vec3((mersenne::randf_cc() - 0.5f) * 4.0f, 0, 2.0f);
+			pos.y -= 2.0f;
+			if (ParticleEffect::spawn(ParticleEffect::Type::SpawnMinion, pos, Quat::identity, nullptr, nullptr, i.item()->team))
+				count++;
+		}
+	}
+}
+
+// the scenarios create, kill and wake up bodies, so this can't run alongside the physics step like tick() does
+void update()
+{
+	if (!state.running)
+		return;
+
+	switch (state.config.scenario)
+	{
+		case Scenario::Match:
+			break;
+		case Scenario::Walkers:
+			minions_fill();
+			break;
+		case Scenario::Ragdolls:
+			minions_fill();
+			if (Team::match_state == Team::MatchState::Active)
+				ragdolls_fill();
+			break;
+		case Scenario::Glass:
+			glass_fill();
+			break;
+		default:
+			vi_assert(false);
+			break;
+	}
+}
+
+void tick()
+{
+	if (!state.running)
+		return;
+
+	const PhysicsStats& physics = Physics::stats;
+	if (physics.last.id != state.physics_step_id)
+	{
+		state.physics_step_id = physics.last.id;
+		state.physics_steps.add(physics.last.time);
+		state.physics_substeps += r64(physics.last.substeps);
+		state.physics_bodies_active += r64(physics.last.bodies_active);
+		state.physics_contacts += r64(physics.last.contacts);
+	}
+	state.physics_sync += r64(physics.sync_static_time) + r64(physics.sync_dynamic_time);
+
+	state.ticks++;
+	state.minions += r64(Minion::list.count());
+	state.debris_awake += r64(Debris::count_awake());
+
+	r64 simulated = r64(Game::time.total) - state.time_start;
+	if (Team::match_state == Team::MatchState::Done
+		|| (state.config.duration > 0.0f && simulated >= r64(state.config.duration)))
+	{
+		state.end = Clock::now();
+		state.running = false;
+		Game::quit = true;
+	}
+}
+
+void report(const char* filename)
+{
+	if (!state.enabled || state.ticks == 0)
+		return;
+
+	if (state.running) // interrupted
+	{
+		state.end = Clock::now();
+		state.running = false;
+	}
+
+	r64 wall = r64(nanoseconds(state.end - state.start)) / 1000000000.0;
+	r64 simulated = r64(Game::time.total) - state.time_start;
+	u64 allocations = allocations_total.load();
+	u64 support_queries = Walker::support_queries - state.support_queries_start;
+	u64 support_cache_hits = Walker::support_cache_hits - state.support_cache_hits_start;
+	r64 raycast_time = Physics::stats.raycast_batch_time - state.raycast_batch_time_start;
+	u64 raycast_rays = Physics::stats.raycast_batch_rays - state.raycast_batch_rays_start;
+
+	// physics step percentiles
+	r64 step_mean = 0.0;
+	r64 step_p50 = 0.0;
+	r64 step_p90 = 0.0;
+	r64 step_p99 = 0.0;
+	r64 step_max = 0.0;
+	s32 steps = state.physics_steps.length;
+	if (steps > 0)
+	{
+		std::sort(state.physics_steps.data, state.physics_steps.data + steps);
+		for (s32 i = 0; i < steps; i++)
+			step_mean += r64(state.physics_steps[i]);
+		step_mean /= r64(steps);
+		step_p50 = r64(state.physics_steps[s32(r64(steps - 1) * 0.5)]);
+		step_p90 = r64(state.physics_steps[s32(r64(steps - 1) * 0.9)]);
+		step_p99 = r64(state.physics_steps[s32(r64(steps - 1) * 0.99)]);
+		step_max = r64(state.physics_steps[steps - 1]);
+	}
+	r64 steps_divisor = r64(vi_max(1, steps));
+
+	vi_debug("Benchmark: %u ticks, %.1fs simulated in %.1fs (%.2fx real time). %.3fms physics step per tick. %llu allocations.",
+		state.ticks,
+		simulated,
+		wall,
+		wall > 0.0 ? simulated / wall : 0.0,
+		step_mean * 1000.0,
+		(unsigned long long)allocations);
+	vi_debug("Benchmark: physics %s, %d job workers.", Physics::multithreaded ? "multithreaded" : "single-threaded", Jobs::workers());
+	vi_debug("Benchmark: physics step %.3fms p50, %.3fms p90, %.3fms p99, %.3fms max. %.2f substeps, %.1f active bodies, %.1f contacts per step. %.3fms syncing per tick.",
+		step_p50 * 1000.0,
+		step_p90 * 1000.0,
+		step_p99 * 1000.0,
+		step_max * 1000.0,
+		state.physics_substeps / steps_divisor,
+		state.physics_bodies_active / steps_divisor,
+		state.physics_contacts / steps_divisor,
+		(state.physics_sync / r64(state.ticks)) * 1000.0);
+	vi_debug("Benchmark: %.1f minions on average. %llu walker support raycasts, %llu served from cache.",
+		state.minions / r64(state.ticks),
+		(unsigned long long)support_queries,
+		(unsigned long long)support_cache_hits);
+	vi_debug("Benchmark: %llu batched rays %s, %.3fms per tick, %.3fus per ray.",
+		(unsigned long long)raycast_rays,
+		Physics::raycast_batch_per_ray ? "cast one at a time" : "cast in parallel",
+		(raycast_time / r64(state.ticks)) * 1000.0,
+		raycast_rays > 0 ? (raycast_time / r64(raycast_rays)) * 1000000.0 : 0.0);
+
+	cJSON* json = cJSON_CreateObject();
+	cJSON_AddStringToObject(json, "level", state.config.level);
+	cJSON_AddStringToObject(json, "game_type", Net::Master::ServerConfig::game_type_string(state.config.game_type));
+	cJSON_AddNumberToObject(json, "seed", r64(state.config.seed));
+	cJSON_AddNumberToObject(json, "ticks", r64(state.ticks));
+	cJSON_AddNumberToObject(json, "simulated", simulated);
+	cJSON_AddNumberToObject(json, "wall", wall);
+	cJSON_AddNumberToObject(json, "speed", wall > 0.0 ? simulated / wall : 0.0);
+	cJSON_AddNumberToObject(json, "physics_step_ms", step_mean * 1000.0);
+	cJSON_AddNumberToObject(json, "physics_multithreaded", s32(Physics::multithreaded));
+	cJSON_AddNumberToObject(json, "job_workers", Jobs::workers());
+	cJSON_AddNumberToObject(json, "allocations", r64(allocations));
+	cJSON_AddStringToObject(json, "scenario", scenario_string(state.config.scenario));
+	cJSON_AddNumberToObject(json, "minions", state.minions / r64(state.ticks));
+	cJSON_AddNumberToObject(json, "debris_awake", state.debris_awake / r64(state.ticks));
+	cJSON_AddNumberToObject(json, "walker_support_queries", r64(support_queries));
+	cJSON_AddNumberToObject(json, "walker_support_cache_hits", r64(support_cache_hits));
+
+	{
+		cJSON* physics = cJSON_CreateObject();
+		cJSON_AddNumberToObject(physics, "steps", r64(steps));
+		cJSON_AddNumberToObject(physics, "step_p50_ms", step_p50 * 1000.0);
+		cJSON_AddNumberToObject(physics, "step_p90_ms", step_p90 * 1000.0);
+		cJSON_AddNumberToObject(physics, "step_p99_ms", step_p99 * 1000.0);
+		cJSON_AddNumberToObject(physics, "step_max_ms", step_max * 1000.0);
+		cJSON_AddNumberToObject(physics, "substeps", state.physics_substeps / steps_divisor);
+		cJSON_AddNumberToObject(physics, "bodies_active", state.physics_bodies_active / steps_divisor);
+		cJSON_AddNumberToObject(physics, "contacts", state.physics_contacts / steps_divisor);
+		cJSON_AddNumberToObject(physics, "sync_ms_per_tick", (state.physics_sync / r64(state.ticks)) * 1000.0);
+		cJSON_AddItemToObject(json, "physics", physics);
+	}
+
+	{
+		cJSON* raycasts = cJSON_CreateObject();
+		cJSON_AddNumberToObject(raycasts, "per_ray", s32(Physics::raycast_batch_per_ray));
+		cJSON_AddNumberToObject(raycasts, "rays", r64(raycast_rays));
+		cJSON_AddNumberToObject(raycasts, "ms_per_tick", (raycast_time / r64(state.ticks)) * 1000.0);
+		cJSON_AddNumberToObject(raycasts, "us_per_ray", raycast_rays > 0 ? (raycast_time / r64(raycast_rays)) * 1000000.0 : 0.0);
+		cJSON_AddItemToObject(json, "raycasts", raycasts);
+	}
+
+	cJSON* systems = cJSON_CreateObject();
+	for (s32 i = 0; i < s32(System::count); i++)
+	{
+		r64 ms = r64(state.ns[i]) / 1000000.0;
+		vi_debug("  %-12s %9.1fms total %7.3fms/tick %10llu allocations", system_names[i], ms, ms / r64(state.ticks), (unsigned long long)state.allocations[i]);
+
+		cJSON* system = cJSON_CreateObject();
+		cJSON_AddNumberToObject(system, "ms", ms);
+		cJSON_AddNumberToObject(system, "ms_per_tick", ms / r64(state.ticks));
+		cJSON_AddNumberToObject(system, "allocations", r64(state.allocations[i]));
+		cJSON_AddItemToObject(systems, system_names[i], system);
+	}
+	cJSON_AddItemToObject(json, "systems", systems);
+
+	char path[MAX_PATH_LENGTH + 1];
+	Loader::user_data_path(path, filename);
+	Json::save(json, path);
+	Json::json_free(json);
+}
+
+}
+
+}
+
+// count allocations for the benchmark. replacing these is all-or-nothing,
+// which is why this file only goes into the benchmark build
+void* operator new(std::size_t size)
+{
+	VI::Benchmark::allocation_count();
+	void* p = malloc(size ? size : 1);
+	if (!p)
+		abort();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+	free(p);
+}
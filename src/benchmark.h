@@ -0,0 +1,70 @@
+#pragma once
+#include "types.h"
+
+namespace VI
+{
+
+// headless bot match simulated as fast as possible with a fixed seed and a fixed timestep,
+// so two runs of the same level and game type can be compared between builds.
+// only the benchmark build (deceiverbench, BENCHMARK=1) has it; everywhere else these calls compile to nothing
+namespace Benchmark
+{
+
+enum class System : s8
+{
+	Loop, // outside Game::update; mostly waiting for the physics thread to finish the previous step
+	Net,
+	AI,
+	Team,
+	Physics, // syncing transforms to and from Bullet
+	Animation,
+	Walkers,
+	Bots,
+	Projectiles,
+	Minions,
+	Drones,
+	Other,
+	count,
+};
+
+// extra load on top of the bot match, to see how physics scales
+enum class Scenario : s8
+{
+	Match, // just the bots
+	Walkers, // minions kept at MAX_MINIONS
+	Ragdolls, // minions killed in waves so BENCHMARK_RAGDOLLS ragdolls are always simulating
+	Glass, // every pane shatters, then shards keep bursting from where the panes were
+	count,
+};
+
+struct Config
+{
+	const char* level;
+	GameType game_type;
+	r32 duration; // in simulated seconds. 0 = until the match ends
+	u32 seed;
+	Scenario scenario;
+	b8 raycasts_per_ray; // see Physics::raycast_batch_per_ray
+};
+
+#if BENCHMARK
+const char* scenario_string(Scenario);
+b8 active();
+void init(const Config&); // call before any threads start
+void start(); // loads the level once the game is initialized
+void lap(System); // charges everything since the last lap to the given system
+void update(); // call from Game::update, while the physics thread is idle; adds the scenario's extra load
+void tick(); // call after every update; quits once the benchmark is done
+void report(const char*);
+#else
+inline b8 active() { return false; }
+inline void start() { }
+inline void lap(System) { }
+inline void update() { }
+inline void tick() { }
+inline void report(const char*) { }
+#endif
+
+}
+
+}
@@ -60,7 +60,7 @@ StaticGeom::StaticGeom(AssetID mesh_id, const Vec3& absolute_pos, const Quat& ab
 	Loader::mesh(model->mesh);
 
 	RigidBody* body = create<RigidBody>(RigidBody::Type::Mesh, Vec3::zero, 0.0f, CollisionStatic | group, ~CollisionStatic & ~CollisionAudio & ~CollisionGlass & ~CollisionParkour & ~CollisionInaccessible & ~CollisionElectric & mask, mesh_id, flags);
-	body->set_restitution(0.75f);
+	body->set_restitution(STATIC_GEOM_RESTITUTION);
 }
 
 PhysicsEntity::PhysicsEntity(AssetID mesh, const Vec3& pos, const Quat& quat, RigidBody::Type type, const Vec3& scale, r32 mass, short filter_group, short filter_mask, s8 flags)
@@ -3,6 +3,7 @@
 #include "asset/font.h"
 #include <cstdio>
 #include "load.h"
+#include "physics.h"
 
 namespace VI
 {
@@ -15,6 +16,7 @@ char Console::fps_text[255];
 UIText Console::debug_text;
 UIText Console::log_text;
 b8 Console::fps_visible = false;
+b8 Console::physics_visible = false;
 s32 Console::fps_count = 0;
 r32 Console::fps_accumulator = 0;
 r32 Console::longest_frame_time = 0;
@@ -66,6 +68,18 @@ void Console::update(const Update& u)
 		debug("%s", fps_text);
 	}
 
+	if (physics_visible)
+	{
+		const PhysicsStats& stats = Physics::stats;
+		debug("physics %.1fms | %d substeps | %d active | %d contacts | sync %.1fms %.1fms",
+			stats.last.time * 1000.0f,
+			stats.last.substeps,
+			stats.last.bodies_active,
+			stats.last.contacts,
+			stats.sync_static_time * 1000.0f,
+			stats.sync_dynamic_time * 1000.0f);
+	}
+
 	if (visible)
 	{
 		b8 update = field.update(u, 1);
@@ -79,6 +93,8 @@ void Console::update(const Update& u)
 				fps_count = 0;
 				fps_accumulator = 0.0f;
 			}
+			else if (strcmp(&field.value[1], "physics") == 0)
+				physics_visible = !physics_visible;
 			else
 				Game::execute(&field.value[1]);
 
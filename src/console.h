@@ -28,6 +28,7 @@ struct Console
 	static r32 fps_accumulator;
 	static r32 longest_frame_time;
 	static b8 fps_visible;
+	static b8 physics_visible;
 
 	static void init();
 	static void update(const Update&);
@@ -9,6 +9,7 @@ namespace VI
 PinArray<Entity, MAX_ENTITIES> Entity::list;
 Array<Ref<Entity>> World::remove_buffer;
 ComponentPoolBase* World::component_pools[MAX_FAMILIES];
+const char* World::component_names[MAX_FAMILIES];
 
 LinkEntry::Data::Data()
 	: id(), revision()
@@ -16,6 +16,7 @@ struct ComponentPoolBase
 	virtual void remove(ID) = 0;
 	virtual Revision revision(ID) = 0;
 	virtual void clear() = 0;
+	virtual s32 count() = 0;
 };
 
 template<typename T> struct Ref
@@ -105,6 +106,11 @@ struct ComponentPool : public ComponentPoolBase
 			T::list.data[i].revision = 0;
 	}
 
+	virtual s32 count()
+	{
+		return T::list.count();
+	}
+
 	virtual Revision revision(ID id)
 	{
 		return T::list[id].revision;
@@ -165,6 +171,7 @@ struct World
 	static Family families;
 	static Array<Ref<Entity>> remove_buffer;
 	static ComponentPoolBase* component_pools[MAX_FAMILIES];
+	static const char* component_names[MAX_FAMILIES];
 
 	static void init();
 
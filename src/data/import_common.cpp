@@ -140,6 +140,85 @@ void DroneNavMesh::read(FILE* f)
 	reverb.read(f);
 }
 
+b8 LevelPvs::cell(const Vec3& p, s32* out) const
+{
+	Vec3 offset = (p - vmin) / chunk_size;
+	Coord c = { s32(floorf(offset.x)), s32(floorf(offset.y)), s32(floorf(offset.z)) };
+	if (!contains(c))
+		return false;
+	*out = index(c);
+	return true;
+}
+
+b8 LevelPvs::blocked(const Vec3& a, const Vec3& b) const
+{
+	s32 cell_a;
+	s32 cell_b;
+	if (chunks.length == 0 || !cell(a, &cell_a) || !cell(b, &cell_b))
+		return false;
+
+	const LevelPvsCell& entry = chunks[cell_a];
+	s32 low = entry.start;
+	s32 high = entry.start + entry.count - 1;
+	while (low <= high)
+	{
+		s32 mid = (low + high) / 2;
+		s32 value = occluded[mid];
+		if (value == cell_b)
+			return true;
+		else if (value < cell_b)
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+	return false;
+}
+
+b8 LevelPvs::read(FILE* f)
+{
+	s32 version;
+	if (fread(&version, sizeof(s32), 1, f) != 1 || version != LEVEL_PVS_VERSION)
+		return false;
+
+	if (fread(&chunk_size, sizeof(r32), 1, f) != 1
+		|| fread(&vmin, sizeof(Vec3), 1, f) != 1
+		|| fread(&size, sizeof(Coord), 1, f) != 1
+		|| !(chunk_size > 0.0f)
+		|| size.x < 0 || size.y < 0 || size.z < 0
+		|| s64(size.x) * s64(size.y) * s64(size.z) > LEVEL_PVS_MAX_CELLS)
+		return false;
+
+	resize();
+	if (s32(fread(chunks.data, sizeof(LevelPvsCell), chunks.length, f)) != chunks.length)
+		return false;
+
+	s32 count;
+	if (fread(&count, sizeof(s32), 1, f) != 1 || count < 0)
+		return false;
+
+	// don't trust the count with an allocation until we know the file is that long
+	long pos = ftell(f);
+	if (pos < 0 || fseek(f, 0, SEEK_END) != 0)
+		return false;
+	long end = ftell(f);
+	if (end < pos || (end - pos) / s64(sizeof(s32)) < s64(count) || fseek(f, pos, SEEK_SET) != 0)
+		return false;
+
+	occluded.resize(count);
+	if (s32(fread(occluded.data, sizeof(s32), count, f)) != count)
+		return false;
+
+	// blocked() binary searches these ranges
+	for (s32 i = 0; i < chunks.length; i++)
+	{
+		const LevelPvsCell& cell = chunks[i];
+		if (cell.start < 0 || cell.count < 0 || s64(cell.start) + s64(cell.count) > s64(occluded.length))
+			return false;
+	}
+
+	return true;
+}
+
 Armature::Armature()
 	: hierarchy(), bind_pose(), inverse_bind_pose(), abs_bind_pose(), bodies()
 {
@@ -69,6 +69,19 @@ struct Mesh
 	void reset();
 };
 
+#define MESH_BVH_VERSION 1
+
+// precomputed Bullet BVH (.bvh) the importer writes next to each level mesh, followed by the serialized btOptimizedBvh.
+// the game builds the BVH itself if any of this doesn't match
+struct MeshBvhHeader
+{
+	s32 version;
+	s32 scalar_size;
+	s32 vertex_count;
+	s32 index_count;
+	u32 size; // of the serialized BVH
+};
+
 template<typename T>
 struct Keyframe
 {
@@ -317,6 +330,26 @@ struct DroneNavMesh : Chunks<DroneNavMeshChunk>
 	void read(FILE*);
 };
 
+#define LEVEL_PVS_VERSION 1
+#define LEVEL_PVS_MAX_CELLS (1 << 24) // sanity limit when reading; far more than any level needs
+
+struct LevelPvsCell
+{
+	s32 start; // into LevelPvs::occluded
+	s32 count;
+};
+
+// coarse visibility between cells of a level (.pvs, next to the nav mesh).
+// a pair of cells is listed only if every line from the first to the second hits the front of static audio geometry
+struct LevelPvs : Chunks<LevelPvsCell>
+{
+	Array<s32> occluded; // for each cell, a sorted range of cell indices it can't see
+
+	b8 cell(const Vec3&, s32*) const;
+	b8 blocked(const Vec3&, const Vec3&) const; // true if a ray between these points is guaranteed to hit static audio geometry
+	b8 read(FILE*); // false if the file is stale, truncated, or inconsistent
+};
+
 template<typename T>
 void clean_name(T& name)
 {
@@ -14,12 +14,13 @@
 namespace VI
 {
 
+s32 Ragdoll::limit = 6;
+
 void Ragdoll::add(Entity* src, Entity* killer)
 {
 	vi_assert(Game::level.local);
 
-	const s32 RAGDOLL_LIMIT = 6;
-	if (Ragdoll::list.count() >= 6)
+	if (Ragdoll::list.count() >= limit)
 	{
 		Ragdoll* oldest_ragdoll = nullptr;
 		r32 oldest_timer = RAGDOLL_TIME;
@@ -29,6 +29,7 @@ struct Ragdoll : public ComponentType<Ragdoll>
 		count,
 	};
 
+	static s32 limit; // past this many, the oldest goes to make room
 	static void add(Entity*, Entity*);
 
 	Array<BoneBody> bodies;
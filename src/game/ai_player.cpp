@@ -7,6 +7,7 @@
 #include "bullet/src/BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "minion.h"
 #include "noise.h"
+#include "shed.h"
 #if DEBUG_AI_CONTROL
 #include "render/views.h"
 #endif
@@ -19,6 +20,7 @@ namespace VI
 
 
 #define REEVAL_INTERVAL 0.25f
+#define REEVAL_INTERVAL_SHED 1.0f // when the server is shedding load
 
 PinArray<PlayerAI, MAX_PLAYERS> PlayerAI::list;
 
@@ -823,20 +825,30 @@ b8 attack_inbound(const PlayerControlAI* control)
 	return control->get<PlayerCommon>()->incoming_attacker() != nullptr;
 }
 
+#define GEOMETRY_QUERY_MAX_RAYS 64
+
 s32 geometry_query(const PlayerControlAI* control, r32 range, r32 angle_range, s32 count)
 {
+	vi_assert(count <= GEOMETRY_QUERY_MAX_RAYS);
+
 	Vec3 pos;
 	Quat rot;
 	control->get<Transform>()->absolute(&pos, &rot);
 
 	s16 mask = ~DRONE_PERMEABLE_MASK & ~control->get<Drone>()->ally_force_field_mask();
-	s32 result = 0;
+	Raycast rays[GEOMETRY_QUERY_MAX_RAYS];
+	RaycastHit hits[GEOMETRY_QUERY_MAX_RAYS];
 	for (s32 i = 0; i < count; i++)
 	{
 		Vec3 ray = rot * (Quat::euler(PI + (mersenne::randf_co() - 0.5f) * angle_range, (PI * 0.5f) + (mersenne::randf_co() - 0.5f) * angle_range, 0) * Vec3(1, 0, 0));
-		btCollisionWorld::ClosestRayResultCallback ray_callback(pos, pos + ray * range);
-		Physics::raycast(&ray_callback, mask);
-		if (ray_callback.hasHit())
+		rays[i] = { pos, pos + ray * range, IDNull, mask };
+	}
+	Physics::raycast_batch(rays, hits, count);
+
+	s32 result = 0;
+	for (s32 i = 0; i < count; i++)
+	{
+		if (hits[i].object)
 			result++;
 	}
 
@@ -1323,7 +1335,7 @@ void PlayerControlAI::update_server(const Update& u)
 				reeval_timer -= u.time.delta;
 				if (reeval_timer < 0.0f)
 				{
-					reeval_timer += REEVAL_INTERVAL;
+					reeval_timer += Shed::active(Shed::Level::Bots) ? REEVAL_INTERVAL_SHED : REEVAL_INTERVAL;
 
 					action_queue.clear();
 					actions_populate();
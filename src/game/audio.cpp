@@ -349,6 +349,13 @@ void AudioEntry::update_spatialization(UpdateType type)
 {
 	if (flag(FlagEnableObstructionOcclusion))
 	{
+		// one raycast per listener, all in one batch
+		Raycast rays[MAX_GAMEPADS];
+		RaycastHit hits[MAX_GAMEPADS];
+		s8 ray_listeners[MAX_GAMEPADS];
+		r32 ray_distances[MAX_GAMEPADS];
+		s32 ray_count = 0;
+
 		for (s32 i = 0; i < MAX_GAMEPADS; i++)
 		{
 			if (Audio::listener_mask & (1 << i))
@@ -363,27 +370,10 @@ void AudioEntry::update_spatialization(UpdateType type)
 					{
 						dir /= distance;
 
-						btCollisionWorld::ClosestRayResultCallback ray_callback(listener.pos, listener.pos + dir * vi_max(0.1f, distance - 0.5f));
-						Physics::raycast(&ray_callback, CollisionAudio | (CollisionAllTeamsForceField & ~Team::force_field_mask(listener.team)));
-						if (ray_callback.hasHit())
-						{
-							obstruction_target[i] = 1.0f;
-							if (distance > 80.0f)
-								occlusion_target[i] = 0.0f;
-							else
-							{
-								if (type == UpdateType::All)
-									pathfind_result(s8(i), AI::audio_pathfind(listener.pos, abs_pos), distance);
-								else
-									AI::audio_pathfind(listener.pos, abs_pos, this, s8(i), distance);
-							}
-						}
-						else
-						{
-							// clear line of sight
-							obstruction_target[i] = 0.0f;
-							occlusion_target[i] = 0.0f;
-						}
+						rays[ray_count] = { listener.pos, listener.pos + dir * vi_max(0.1f, distance - 0.5f), IDNull, s16(CollisionAudio | (CollisionAllTeamsForceField & ~Team::force_field_mask(listener.team))) };
+						ray_listeners[ray_count] = s8(i);
+						ray_distances[ray_count] = distance;
+						ray_count++;
 					}
 					else
 					{
@@ -400,6 +390,34 @@ void AudioEntry::update_spatialization(UpdateType type)
 				}
 			}
 		}
+
+		Physics::raycast_batch(rays, hits, ray_count);
+
+		for (s32 j = 0; j < ray_count; j++)
+		{
+			s8 i = ray_listeners[j];
+			r32 distance = ray_distances[j];
+			if (hits[j].object)
+			{
+				obstruction_target[i] = 1.0f;
+				if (distance > 80.0f)
+					occlusion_target[i] = 0.0f;
+				else
+				{
+					const Audio::Listener& listener = Audio::listener[i];
+					if (type == UpdateType::All)
+						pathfind_result(i, AI::audio_pathfind(listener.pos, abs_pos), distance);
+					else
+						AI::audio_pathfind(listener.pos, abs_pos, this, i, distance);
+				}
+			}
+			else
+			{
+				// clear line of sight
+				obstruction_target[i] = 0.0f;
+				occlusion_target[i] = 0.0f;
+			}
+		}
 	}
 
 	if (flag(FlagEnableReverb))
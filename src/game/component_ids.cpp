@@ -74,7 +74,7 @@ template<> ComponentPool<TYPE> ComponentType<TYPE>::pool;
 
 #undef COMPONENT_TYPE
 
-#define COMPONENT_TYPE(INDEX, TYPE) component_pools[INDEX] = &TYPE::pool;
+#define COMPONENT_TYPE(INDEX, TYPE) component_pools[INDEX] = &TYPE::pool; component_names[INDEX] = #TYPE;
 
 void World::init()
 {
@@ -16,7 +16,7 @@
 // if you change this, make sure to allocate more physics categories for each team's force field
 #define MAX_TEAMS 4
 
-#define GAME_VERSION 31
+#define GAME_VERSION 32
 
 #define STEAM_APP_ID 728100
 #define DISCORD_APP_ID "367724608469860353"
@@ -50,6 +50,7 @@
 #define NET_MAX_SEQUENCE_GAP 180
 #define NET_PREVIOUS_SEQUENCES_SEARCH NET_MAX_SEQUENCE_GAP
 #define NET_TIMEOUT (256.0f * (1.0f / 60.0f))
+#define NET_RESUME_WINDOW 15.0f // how long a timed-out client's players wait for them to reconnect
 #define NET_MAX_MESSAGES_SIZE 1000
 #define NET_SEQUENCE_RESEND_BUFFER NET_ACK_PREVIOUS_SEQUENCES
 #define NET_HISTORY_SIZE 256
@@ -180,6 +181,7 @@
 #define GRENADE_RANGE 13.0f
 #define GRENADE_DELAY 2.0f
 #define GRENADE_QUICK_FUSE 0.3f
+#define GRENADE_COLLISION_FILTER (~CollisionParkour & ~CollisionElectric & ~CollisionStatic & ~CollisionAudio & ~CollisionInaccessible & ~CollisionAllTeamsForceField & ~CollisionWalker & ~CollisionMinionMoving & ~CollisionGlass)
 
 #define MINION_SPAWN_HEIGHT 0.5f
 
@@ -192,5 +194,6 @@
 #define BOLTER_INTERVAL 0.125f
 
 #define BATTERY_RADIUS 0.55f
+#define BATTERY_COLLISION_FILTER (~CollisionAllTeamsForceField & ~CollisionWalker & ~CollisionMinionMoving)
 
 #define AIR_CONTROL_ACCEL 5.0f
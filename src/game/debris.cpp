@@ -0,0 +1,271 @@
+#include "debris.h"
+#include "physics.h"
+#include "data/pin_array.h"
+
+namespace VI
+{
+
+namespace Debris
+{
+
+#define DEBRIS_FRICTION 0.3f // fraction of tangential velocity lost on each bounce
+#define DEBRIS_SPIN_LOSS 0.5f // fraction of angular velocity lost on each bounce
+#define DEBRIS_SLEEP_SPEED 0.25f
+#define DEBRIS_SLEEP_TIME 0.2f // seconds a body has to sit still on a floor before it stops simulating
+#define DEBRIS_FLOOR 0.5f // minimum normal Y of a surface a body can rest on
+#define DEBRIS_SETTLE 0.5f // fraction of the remaining tilt flat bodies lose on each floor contact
+
+struct State
+{
+	// linear motion is kept in structure-of-arrays form so the integration loop vectorizes
+	r32 pos_x[DEBRIS_MAX];
+	r32 pos_y[DEBRIS_MAX];
+	r32 pos_z[DEBRIS_MAX];
+	r32 next_x[DEBRIS_MAX];
+	r32 next_y[DEBRIS_MAX];
+	r32 next_z[DEBRIS_MAX];
+	r32 velocity_x[DEBRIS_MAX];
+	r32 velocity_y[DEBRIS_MAX];
+	r32 velocity_z[DEBRIS_MAX];
+	r32 damping[DEBRIS_MAX];
+	r32 awake[DEBRIS_MAX]; // 1 or 0; scales the step so sleeping and free slots pass through untouched
+	Quat rot[DEBRIS_MAX];
+	Vec3 angular_velocity[DEBRIS_MAX];
+	r32 radius[DEBRIS_MAX];
+	r32 restitution[DEBRIS_MAX];
+	r32 rest_timer[DEBRIS_MAX];
+	u32 sequence[DEBRIS_MAX]; // spawn order, for eviction
+	u16 generation[DEBRIS_MAX];
+	s16 mask[DEBRIS_MAX];
+	b8 flat[DEBRIS_MAX];
+	Bitmask<DEBRIS_MAX> active;
+	Array<Raycast> rays;
+	Array<RaycastHit> hits;
+	Array<s32> ray_bodies;
+	u32 sequence_next;
+};
+State state;
+
+inline s32 handle_slot(Handle h)
+{
+	return h & 0xffff;
+}
+
+inline b8 handle_valid(Handle h)
+{
+	s32 slot = handle_slot(h);
+	return h > 0 && slot < DEBRIS_MAX && state.active.get(slot) && state.generation[slot] == u16(h >> 16);
+}
+
+void free_slot(s32 slot)
+{
+	state.active.set(slot, false);
+	state.awake[slot] = 0.0f;
+}
+
+Handle add(const Def& def)
+{
+	s32 slot = -1;
+	for (s32 i = 0; i < DEBRIS_MAX; i++)
+	{
+		if (!state.active.get(i))
+		{
+			slot = i;
+			break;
+		}
+	}
+
+	if (slot == -1)
+	{
+		// evict the oldest
+		slot = state.active.start;
+		for (s32 i = state.active.next(slot); i < state.active.end; i = state.active.next(i))
+		{
+			if (state.sequence[i] - state.sequence[slot] > 0x7fffffff) // handles wraparound
+				slot = i;
+		}
+		free_slot(slot);
+	}
+
+	state.active.set(slot, true);
+	state.generation[slot] = u16((state.generation[slot] % 0x7fff) + 1); // never 0, and fits in a positive handle
+	state.sequence[slot] = state.sequence_next++;
+	state.pos_x[slot] = def.pos.x;
+	state.pos_y[slot] = def.pos.y;
+	state.pos_z[slot] = def.pos.z;
+	state.velocity_x[slot] = def.velocity.x;
+	state.velocity_y[slot] = def.velocity.y;
+	state.velocity_z[slot] = def.velocity.z;
+	state.damping[slot] = def.damping;
+	state.awake[slot] = 1.0f;
+	state.rot[slot] = def.rot;
+	state.angular_velocity[slot] = def.angular_velocity;
+	state.radius[slot] = def.radius;
+	state.restitution[slot] = def.restitution * STATIC_GEOM_RESTITUTION; // debris only bounces off level geometry
+	state.rest_timer[slot] = 0.0f;
+	state.mask[slot] = def.mask;
+	state.flat[slot] = def.flat;
+
+	return Handle(slot | (s32(state.generation[slot]) << 16));
+}
+
+void remove(Handle h)
+{
+	if (handle_valid(h))
+		free_slot(handle_slot(h));
+}
+
+b8 get(Handle h, Vec3* pos, Quat* rot)
+{
+	if (!handle_valid(h))
+		return false;
+	s32 slot = handle_slot(h);
+	*pos = Vec3(state.pos_x[slot], state.pos_y[slot], state.pos_z[slot]);
+	*rot = state.rot[slot];
+	return true;
+}
+
+void settle(s32 slot, const Vec3& normal)
+{
+	Vec3 z = state.rot[slot] * Vec3(0, 0, 1);
+	if (z.dot(normal) < 0.0f) // either side can face up
+		z = -z;
+	Vec3 axis = z.cross(normal);
+	r32 sin_angle = axis.length();
+	if (sin_angle > 0.001f)
+		state.rot[slot] = Quat::normalize(Quat(asinf(vi_min(1.0f, sin_angle)) * DEBRIS_SETTLE, axis / sin_angle) * state.rot[slot]);
+}
+
+void update(r32 dt)
+{
+	if (!state.active.any() || dt <= 0.0f)
+		return;
+
+	Vec3 gravity = Physics::btWorld->getGravity();
+	s32 end = state.active.end;
+
+	// integrate
+	for (s32 i = 0; i < end; i++)
+	{
+		r32 step = dt * state.awake[i];
+		r32 drag = 1.0f - state.damping[i] * step;
+		state.velocity_x[i] = (state.velocity_x[i] + gravity.x * step) * drag;
+		state.velocity_y[i] = (state.velocity_y[i] + gravity.y * step) * drag;
+		state.velocity_z[i] = (state.velocity_z[i] + gravity.z * step) * drag;
+		state.next_x[i] = state.pos_x[i] + state.velocity_x[i] * step;
+		state.next_y[i] = state.pos_y[i] + state.velocity_y[i] * step;
+		state.next_z[i] = state.pos_z[i] + state.velocity_z[i] * step;
+	}
+
+	// sweep every moving body against static geometry in one batch
+	state.rays.length = 0;
+	state.ray_bodies.length = 0;
+	for (s32 i = state.active.start; i < end; i = state.active.next(i))
+	{
+		if (state.awake[i] == 0.0f)
+			continue;
+
+		Vec3 angular_velocity = state.angular_velocity[i];
+		r32 spin = angular_velocity.length();
+		if (spin > 0.0001f)
+			state.rot[i] = Quat::normalize(Quat(spin * dt, angular_velocity / spin) * state.rot[i]);
+		state.angular_velocity[i] = angular_velocity * vi_max(0.0f, 1.0f - state.damping[i] * dt);
+
+		Vec3 pos(state.pos_x[i], state.pos_y[i], state.pos_z[i]);
+		Vec3 next(state.next_x[i], state.next_y[i], state.next_z[i]);
+		Vec3 move = next - pos;
+		r32 distance = move.length();
+		if (distance > 0.0001f)
+		{
+			state.rays.add({ pos, next + move * (state.radius[i] / distance), IDNull, state.mask[i] });
+			state.ray_bodies.add(i);
+		}
+	}
+
+	state.hits.resize(state.rays.length);
+	Physics::raycast_batch(state.rays.data, state.hits.data, state.rays.length);
+
+	// commit every integrated position, then pull back the bodies that hit something
+	for (s32 i = state.active.start; i < end; i = state.active.next(i))
+	{
+		state.pos_x[i] = state.next_x[i];
+		state.pos_y[i] = state.next_y[i];
+		state.pos_z[i] = state.next_z[i];
+	}
+
+	for (s32 j = 0; j < state.ray_bodies.length; j++)
+	{
+		s32 i = state.ray_bodies[j];
+		const RaycastHit& hit = state.hits[j];
+		if (!hit.object)
+		{
+			state.rest_timer[i] = 0.0f;
+			continue;
+		}
+
+		Vec3 velocity(state.velocity_x[i], state.velocity_y[i], state.velocity_z[i]);
+		r32 into = velocity.dot(hit.normal);
+		if (into < 0.0f)
+		{
+			Vec3 tangent = velocity - hit.normal * into;
+			velocity = tangent * (1.0f - DEBRIS_FRICTION) - hit.normal * (into * state.restitution[i]);
+			state.angular_velocity[i] *= 1.0f - DEBRIS_SPIN_LOSS;
+		}
+
+		Vec3 pos = hit.pos + hit.normal * state.radius[i];
+		state.pos_x[i] = pos.x;
+		state.pos_y[i] = pos.y;
+		state.pos_z[i] = pos.z;
+
+		if (hit.normal.y > DEBRIS_FLOOR)
+		{
+			if (state.flat[i])
+				settle(i, hit.normal);
+
+			if (velocity.length_squared() < DEBRIS_SLEEP_SPEED * DEBRIS_SLEEP_SPEED)
+			{
+				state.rest_timer[i] += dt;
+				if (state.rest_timer[i] > DEBRIS_SLEEP_TIME)
+				{
+					// static geometry doesn't move, so a resting body never needs another query
+					state.awake[i] = 0.0f;
+					velocity = Vec3::zero;
+					state.angular_velocity[i] = Vec3::zero;
+				}
+			}
+			else
+				state.rest_timer[i] = 0.0f;
+		}
+
+		state.velocity_x[i] = velocity.x;
+		state.velocity_y[i] = velocity.y;
+		state.velocity_z[i] = velocity.z;
+	}
+}
+
+void clear()
+{
+	for (s32 i = state.active.start; i < state.active.end; i = state.active.next(i))
+		state.awake[i] = 0.0f;
+	state.active.clear();
+}
+
+s32 count()
+{
+	return state.active.count();
+}
+
+s32 count_awake()
+{
+	s32 result = 0;
+	for (s32 i = state.active.start; i < state.active.end; i = state.active.next(i))
+	{
+		if (state.awake[i] != 0.0f)
+			result++;
+	}
+	return result;
+}
+
+}
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "types.h"
+#include "lmath.h"
+
+namespace VI
+{
+
+// cosmetic bits (shell casings, glass shards) that bounce off static geometry without going through Bullet.
+// each body collides as a sphere against whatever one batched raycast per frame finds.
+// bodies live in a fixed pool and stop querying once they come to rest
+namespace Debris
+{
+
+#define DEBRIS_MAX 512
+
+struct Def
+{
+	Quat rot;
+	Vec3 pos;
+	Vec3 velocity;
+	Vec3 angular_velocity;
+	r32 radius;
+	r32 restitution; // of the body itself. combined with the level geometry's the way Bullet does it
+	r32 damping; // fraction of linear and angular velocity lost per second
+	s16 mask; // collision groups to bounce off
+	b8 flat; // settles with its local Z axis along the surface normal
+};
+
+typedef s32 Handle; // slot in the low 16 bits, generation in the high 16. never 0
+
+Handle add(const Def&); // when the pool is full, the oldest body is evicted to make room
+void remove(Handle);
+b8 get(Handle, Vec3*, Quat*); // false if the body has been evicted
+void update(r32); // update thread only
+void clear();
+s32 count();
+s32 count_awake();
+
+}
+
+}
@@ -668,7 +668,7 @@ BatteryEntity::BatteryEntity(const Vec3& p, SpawnPoint* spawn, AI::Team team)
 
 	model->offset.scale(Vec3(BATTERY_RADIUS - 0.2f));
 
-	RigidBody* body = create<RigidBody>(RigidBody::Type::Sphere, Vec3(BATTERY_RADIUS), 0.1f, CollisionTarget, ~CollisionAllTeamsForceField & ~CollisionWalker & ~CollisionMinionMoving);
+	RigidBody* body = create<RigidBody>(RigidBody::Type::Sphere, Vec3(BATTERY_RADIUS), 0.1f, CollisionTarget, BATTERY_COLLISION_FILTER);
 	body->set_damping(0.5f, 0.5f);
 	body->set_ccd(true);
 
@@ -2092,27 +2092,21 @@ GlassShard* glass_shard_init()
 	return shard;
 }
 
-void glass_shard_physics(const Vec3* vertices, s32 vertex_count, const Vec3& pos, const Quat& rot, r32 mass, btRigidBody** out_body, btCollisionShape** out_shape)
+// the impulse is applied the way Bullet would apply it to a thin plate of the given radius and mass
+Debris::Handle glass_shard_physics(const Vec3& pos, const Quat& rot, r32 radius, r32 mass, const Vec3& impulse_pos, const Vec3& impulse)
 {
-	btConvexHullShape* btShape = new btConvexHullShape((const btScalar*)(vertices), vertex_count, sizeof(Vec3));
-
-	btVector3 localInertia(0, 0, 0);
-	btShape->calculateLocalInertia(mass, localInertia);
-
-	btRigidBody::btRigidBodyConstructionInfo info(mass, 0, btShape, localInertia);
-
-	info.m_startWorldTransform = btTransform(rot, pos);
-	btRigidBody* btBody = new btRigidBody(info);
-	btBody->setWorldTransform(info.m_startWorldTransform);
-
-	btBody->setUserIndex(-1);
-	btBody->setRestitution(0.5f);
-	btBody->setDamping(0.25f, 0.25f);
-
-	Physics::btWorld->addRigidBody(btBody, CollisionDroneIgnore, CollisionStatic | CollisionElectric | CollisionParkour | CollisionInaccessible);
-
-	*out_body = btBody;
-	*out_shape = btShape;
+	Debris::Def def;
+	def.pos = pos;
+	def.rot = rot;
+	def.velocity = impulse / mass;
+	r32 inertia = mass * radius * radius * 0.25f;
+	def.angular_velocity = ((impulse_pos - pos) * 0.25f).cross(impulse) / inertia;
+	def.radius = 0.025f; // half the thickness
+	def.restitution = 0.5f;
+	def.damping = 0.25f;
+	def.mask = CollisionStatic | CollisionElectric | CollisionParkour | CollisionInaccessible;
+	def.flat = true;
+	return Debris::add(def);
 }
 
 GlassShard* GlassShard::add(const Vec2& a, const Vec2& b, const Vec2& c, const Vec3& pos, const Quat& rot, const Vec3& impulse_pos, const Vec3& impulse)
@@ -2144,8 +2138,7 @@ GlassShard* GlassShard::add(const Vec2& a, const Vec2& b, const Vec2& c, const V
 			Vec3(c_recentered.x, c_recentered.y, 0.05f),
 		};
 		r32 radius = sqrtf(vi_max(a_recentered.length_squared(), vi_max(b_recentered.length_squared(), c_recentered.length_squared())));
-		glass_shard_physics(vertices, 6, shard->pos, shard->rot, radius * radius * 0.2f, &shard->btBody, &shard->btShape);
-		shard->btBody->applyImpulse(impulse, (impulse_pos - shard->pos) * 0.25f);
+		shard->debris = glass_shard_physics(shard->pos, shard->rot, radius, radius * radius * 0.2f, impulse_pos, impulse);
 		sync->write<s32>(3);
 		sync->write<Vec3>(vertices, 3);
 	}
@@ -2209,8 +2202,7 @@ GlassShard* GlassShard::add(const Vec2& a, const Vec2& b, const Vec2& c, const V
 			Vec3(d_recentered.x, d_recentered.y, 0.05f),
 		};
 		r32 radius = sqrtf(vi_max(a_recentered.length_squared(), vi_max(b_recentered.length_squared(), vi_max(c_recentered.length_squared(), d_recentered.length_squared()))));
-		glass_shard_physics(vertices, 8, shard->pos, shard->rot, radius * radius * 0.2f, &shard->btBody, &shard->btShape);
-		shard->btBody->applyImpulse(impulse, (impulse_pos - shard->pos) * 0.25f);
+		shard->debris = glass_shard_physics(shard->pos, shard->rot, radius, radius * radius * 0.2f, impulse_pos, impulse);
 		sync->write<s32>(4);
 		sync->write<Vec3>(vertices, 4);
 	}
@@ -2253,9 +2245,7 @@ void GlassShard::clear()
 void GlassShard::cleanup()
 {
 	Loader::dynamic_mesh_free(mesh_id);
-	Physics::btWorld->removeRigidBody(btBody);
-	delete btBody;
-	delete btShape;
+	Debris::remove(debris);
 }
 
 void GlassShard::sync_physics()
@@ -2263,9 +2253,7 @@ void GlassShard::sync_physics()
 	for (s32 i = 0; i < list.length; i++)
 	{
 		GlassShard* s = &list[i];
-		btTransform transform = s->btBody->getInterpolationWorldTransform();
-		s->pos = transform.getOrigin();
-		s->rot = transform.getRotation();
+		Debris::get(s->debris, &s->pos, &s->rot);
 	}
 }
 
@@ -2275,7 +2263,10 @@ void GlassShard::update_all(const Update& u)
 	for (s32 i = 0; i < list.length; i++)
 	{
 		GlassShard* shard = &list[i];
-		if (u.time.total - shard->timestamp > GLASS_SHARD_LIFETIME)
+		Vec3 pos;
+		Quat rot;
+		if (u.time.total - shard->timestamp > GLASS_SHARD_LIFETIME
+			|| !Debris::get(shard->debris, &pos, &rot)) // evicted to make room for newer debris
 		{
 			shard->cleanup();
 			list.remove(i);
@@ -2336,6 +2327,9 @@ void GlassShard::draw_all(const RenderParams& params)
 
 void Glass::shatter_all(const Vec3& start, const Vec3& end)
 {
+	if (list.count() == 0)
+		return;
+
 	btCollisionWorld::AllHitsRayResultCallback ray_callback(start, end);
 	Physics::raycast(&ray_callback, CollisionGlass);
 	for (s32 i = 0; i < ray_callback.m_collisionObjects.size(); i++)
@@ -2535,34 +2529,49 @@ b8 Turret::net_msg(Net::StreamRead* p, Net::MessageSource src)
 	return true;
 }
 
-b8 Turret::can_see(Entity* target) const
+// false if the target is definitely out of sight. otherwise fills in the line of sight raycast
+b8 turret_sight_ray(const Turret* turret, Entity* target, Raycast* ray)
 {
-	Vec3 pos = get<Transform>()->absolute_pos();
+	Vec3 pos = turret->get<Transform>()->absolute_pos();
 
 	Vec3 target_pos = target->has<Target>() ? target->get<Target>()->absolute_pos() : target->get<Transform>()->absolute_pos();
 
-	if (!target->has<ForceField>() && ForceField::hash(team, pos) != ForceField::hash(team, target_pos))
+	if (!target->has<ForceField>() && ForceField::hash(turret->team, pos) != ForceField::hash(turret->team, target_pos))
 		return false;
 
 	Vec3 to_target = target_pos - pos;
 	float distance_to_target = to_target.length();
 	if (distance_to_target < TURRET_RANGE)
 	{
-		RaycastCallbackExcept ray_callback(pos, target_pos, entity());
-		Physics::raycast(&ray_callback, (CollisionStatic | CollisionInaccessible | CollisionElectric | CollisionAllTeamsForceField) & ~Team::force_field_mask(team));
-		if (ray_callback.hasHit())
-		{
-			Entity* hit = &Entity::list[ray_callback.m_collisionObject->getUserIndex()];
-			if (hit->has<ForceFieldCollision>())
-				hit = hit->get<ForceFieldCollision>()->field.ref()->entity();
-			return hit == target;
-		}
-		else
-			return true;
+		*ray = { pos, target_pos, turret->entity_id, s16((CollisionStatic | CollisionInaccessible | CollisionElectric | CollisionAllTeamsForceField) & ~Team::force_field_mask(turret->team)) };
+		return true;
 	}
 	return false;
 }
 
+b8 turret_sight_hit(Entity* target, const RaycastHit& hit)
+{
+	if (hit.object)
+	{
+		Entity* e = &Entity::list[hit.object->getUserIndex()];
+		if (e->has<ForceFieldCollision>())
+			e = e->get<ForceFieldCollision>()->field.ref()->entity();
+		return e == target;
+	}
+	else
+		return true;
+}
+
+b8 Turret::can_see(Entity* target) const
+{
+	Raycast ray;
+	if (!turret_sight_ray(this, target, &ray))
+		return false;
+	RaycastHit hit;
+	Physics::raycast_batch(&ray, &hit, 1);
+	return turret_sight_hit(target, hit);
+}
+
 s32 turret_priority(Entity* e)
 {
 	if (e->has<Battery>() || e->has<SpawnPoint>())
@@ -2573,6 +2582,10 @@ s32 turret_priority(Entity* e)
 		return 1;
 }
 
+Array<Entity*> turret_candidates;
+Array<Raycast> turret_rays;
+Array<RaycastHit> turret_hits;
+
 void Turret::check_target()
 {
 	// if we are targeting an enemy
@@ -2585,20 +2598,38 @@ void Turret::check_target()
 
 	Ref<Entity> target_new = nullptr;
 
-	s32 target_priority = 0;
+	// line of sight to every candidate is checked in one batch
+	turret_candidates.length = 0;
+	turret_rays.length = 0;
 	for (auto i = Health::list.iterator(); !i.is_last(); i.next())
 	{
 		Entity* e = i.item()->entity();
 		AI::Team e_team;
 		AI::entity_info(e, team, &e_team);
+		Raycast ray;
 		if (e_team != AI::TeamNone
 			&& e_team != team
-			&& can_see(i.item()->entity()))
+			&& turret_priority(e) > 0
+			&& turret_sight_ray(this, e, &ray))
 		{
-			s32 candidate_priority = turret_priority(i.item()->entity());
+			turret_candidates.add(e);
+			turret_rays.add(ray);
+		}
+	}
+
+	turret_hits.resize(turret_rays.length);
+	Physics::raycast_batch(turret_rays.data, turret_hits.data, turret_rays.length);
+
+	s32 target_priority = 0;
+	for (s32 i = 0; i < turret_candidates.length; i++)
+	{
+		Entity* e = turret_candidates[i];
+		if (turret_sight_hit(e, turret_hits[i]))
+		{
+			s32 candidate_priority = turret_priority(e);
 			if (candidate_priority > target_priority)
 			{
-				target_new = i.item()->entity();
+				target_new = e;
 				target_priority = candidate_priority;
 			}
 		}
@@ -3258,6 +3289,239 @@ b8 Bolt::simulate(r32 dt, Hit* out_hit, const Net::StateFrame* state_frame)
 	return false;
 }
 
+#define BOLT_TARGET_CELL 4.0f // size of a cell in the per-tick target grid
+#define BOLT_TARGET_BUCKETS 256 // power of two
+#define BOLT_TARGET_QUERY_CELLS 27 // a ray touching more cells than this checks every target instead
+
+struct BoltBatch
+{
+	// targets in Target::list order, bucketed by the grid cells their spheres overlap.
+	// bucket i holds bucket_targets[bucket_start[i]] through bucket_targets[bucket_start[i + 1] - 1]
+	Array<Vec3> target_pos;
+	Array<r32> target_radius;
+	Array<Entity*> target_entity;
+	Array<u32> target_visited; // query stamp, so targets listed in several buckets are only tested once
+	Array<s32> bucket_targets;
+	s32 bucket_start[BOLT_TARGET_BUCKETS + 1];
+	s32 bucket_cursor[BOLT_TARGET_BUCKETS];
+	Array<s32> candidates;
+	u32 query;
+
+	Array<Raycast> rays;
+	Array<RaycastHit> hits;
+	Array<s32> ray_index; // by Bolt::list index. -1 if the bolt has no ray this tick
+};
+BoltBatch bolt_batch;
+
+inline s32 bolt_target_cell(r32 x)
+{
+	return s32(floorf(x / BOLT_TARGET_CELL));
+}
+
+inline s32 bolt_target_bucket(s32 x, s32 y, s32 z)
+{
+	return s32(((u32(x) * 73856093u) ^ (u32(y) * 19349663u) ^ (u32(z) * 83492791u)) & (BOLT_TARGET_BUCKETS - 1));
+}
+
+void bolt_targets_build(BoltBatch* b)
+{
+	b->target_pos.length = 0;
+	b->target_radius.length = 0;
+	b->target_entity.length = 0;
+	for (auto i = Target::list.iterator(); !i.is_last(); i.next())
+	{
+		b->target_pos.add(i.item()->absolute_pos());
+		b->target_radius.add(i.item()->radius());
+		b->target_entity.add(i.item()->entity());
+	}
+	b->target_visited.resize(b->target_pos.length);
+
+	// count, then fill
+	memset(b->bucket_start, 0, sizeof(b->bucket_start));
+	for (s32 pass = 0; pass < 2; pass++)
+	{
+		for (s32 i = 0; i < b->target_pos.length; i++)
+		{
+			Vec3 radius(b->target_radius[i]);
+			Vec3 min = b->target_pos[i] - radius;
+			Vec3 max = b->target_pos[i] + radius;
+			for (s32 x = bolt_target_cell(min.x); x <= bolt_target_cell(max.x); x++)
+			{
+				for (s32 y = bolt_target_cell(min.y); y <= bolt_target_cell(max.y); y++)
+				{
+					for (s32 z = bolt_target_cell(min.z); z <= bolt_target_cell(max.z); z++)
+					{
+						s32 bucket = bolt_target_bucket(x, y, z);
+						if (pass == 0)
+							b->bucket_start[bucket + 1]++;
+						else
+						{
+							b->bucket_targets[b->bucket_cursor[bucket]] = i;
+							b->bucket_cursor[bucket]++;
+						}
+					}
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			for (s32 i = 0; i < BOLT_TARGET_BUCKETS; i++)
+			{
+				b->bucket_start[i + 1] += b->bucket_start[i];
+				b->bucket_cursor[i] = b->bucket_start[i];
+			}
+			b->bucket_targets.resize(b->bucket_start[BOLT_TARGET_BUCKETS]);
+		}
+	}
+}
+
+// targets whose grid cells the segment's bounding box touches
+void bolt_targets_query(BoltBatch* b, const Vec3& start, const Vec3& end)
+{
+	b->candidates.length = 0;
+
+	s32 min_x = bolt_target_cell(vi_min(start.x, end.x));
+	s32 min_y = bolt_target_cell(vi_min(start.y, end.y));
+	s32 min_z = bolt_target_cell(vi_min(start.z, end.z));
+	s32 max_x = bolt_target_cell(vi_max(start.x, end.x));
+	s32 max_y = bolt_target_cell(vi_max(start.y, end.y));
+	s32 max_z = bolt_target_cell(vi_max(start.z, end.z));
+	if ((max_x - min_x + 1) * (max_y - min_y + 1) * (max_z - min_z + 1) > BOLT_TARGET_QUERY_CELLS)
+	{
+		for (s32 i = 0; i < b->target_pos.length; i++)
+			b->candidates.add(i);
+		return;
+	}
+
+	b->query++;
+	for (s32 x = min_x; x <= max_x; x++)
+	{
+		for (s32 y = min_y; y <= max_y; y++)
+		{
+			for (s32 z = min_z; z <= max_z; z++)
+			{
+				s32 bucket = bolt_target_bucket(x, y, z);
+				for (s32 i = b->bucket_start[bucket]; i < b->bucket_start[bucket + 1]; i++)
+				{
+					s32 target = b->bucket_targets[i];
+					if (b->target_visited[target] != b->query)
+					{
+						b->target_visited[target] = b->query;
+						b->candidates.add(target);
+					}
+				}
+			}
+		}
+	}
+}
+
+// same as Bolt::raycast with the default filter and no state frame, using this tick's batched results
+b8 bolt_raycast_batched(BoltBatch* b, s32 ray, AI::Team team, Bolt::Hit* out_hit)
+{
+	const Raycast& r = b->rays[ray];
+	const RaycastHit& environment = b->hits[ray];
+
+	out_hit->entity = nullptr;
+	r32 closest_hit_distance_sq = FLT_MAX;
+	s32 closest_target = -1;
+
+	if (environment.object)
+	{
+		out_hit->point = environment.pos;
+		out_hit->normal = environment.normal;
+		out_hit->entity = &Entity::list[environment.object->getUserIndex()];
+		closest_hit_distance_sq = (out_hit->point - r.start).length_squared();
+	}
+
+	bolt_targets_query(b, r.start, r.end);
+	for (s32 i = 0; i < b->candidates.length; i++)
+	{
+		s32 target = b->candidates[i];
+		const Vec3& p = b->target_pos[target];
+		Vec3 intersection;
+		if (LMath::ray_sphere_intersect(r.start, r.end, p, b->target_radius[target], &intersection))
+		{
+			// candidates aren't in list order, so break ties the way the list would have
+			r32 distance_sq = (intersection - r.start).length_squared();
+			if ((distance_sq < closest_hit_distance_sq || (distance_sq == closest_hit_distance_sq && target < closest_target))
+				&& Bolt::default_raycast_filter(b->target_entity[target], team))
+			{
+				out_hit->point = intersection;
+				out_hit->normal = Vec3::normalize(intersection - p);
+				out_hit->entity = b->target_entity[target];
+				closest_hit_distance_sq = distance_sq;
+				closest_target = target;
+			}
+		}
+	}
+
+	return out_hit->entity;
+}
+
+// every bolt's environment ray goes out in one batch up front, and targets are bucketed once.
+// a hit can change the world for the bolts after it, so from then on they fall back to simulate
+void Bolt::simulate_all(r32 dt)
+{
+	vi_assert(Game::level.local);
+	BoltBatch* b = &bolt_batch;
+
+	b->rays.length = 0;
+	b->ray_index.resize(list.mask.end);
+	for (s32 i = 0; i < b->ray_index.length; i++)
+		b->ray_index[i] = -1;
+
+	for (auto i = list.iterator(); !i.is_last(); i.next())
+	{
+		Bolt* bolt = i.item();
+		if (bolt->visible() && bolt->remaining_lifetime - dt >= 0.0f) // not fizzling this tick
+		{
+			b->ray_index[i.index] = b->rays.length;
+			Raycast* ray = b->rays.add();
+			ray->start = bolt->get<Transform>()->absolute_pos();
+			Vec3 next_pos = ray->start + bolt->velocity * dt;
+			ray->end = next_pos + Vec3::normalize(bolt->velocity) * BOLT_LENGTH;
+			ray->ignore = IDNull;
+			ray->mask = CollisionStatic | (CollisionAllTeamsForceField & raycast_mask(bolt->team));
+		}
+	}
+
+	if (b->rays.length > 0)
+	{
+		b->hits.resize(b->rays.length);
+		Physics::raycast_batch(b->rays.data, b->hits.data, b->rays.length);
+		bolt_targets_build(b);
+	}
+
+	b8 batch_valid = true;
+	for (auto i = list.iterator(); !i.is_last(); i.next())
+	{
+		Bolt* bolt = i.item();
+		s32 ray = i.index < b->ray_index.length ? b->ray_index[i.index] : -1;
+		if (ray == -1 || !batch_valid)
+		{
+			if (bolt->simulate(dt))
+				batch_valid = false;
+			continue;
+		}
+
+		const Raycast& r = b->rays[ray];
+		bolt->remaining_lifetime -= dt;
+		Vec3 next_pos = r.start + bolt->velocity * dt;
+
+		Glass::shatter_all(r.start, r.end);
+
+		Hit hit;
+		if (bolt_raycast_batched(b, ray, bolt->team, &hit))
+		{
+			bolt->hit_entity(hit);
+			batch_valid = false;
+		}
+		else
+			bolt->get<Transform>()->absolute_pos(next_pos);
+	}
+}
+
 r32 Bolt::particle_accumulator;
 void Bolt::update_client_all(const Update& u)
 {
@@ -3807,28 +4071,18 @@ void ShellCasing::spawn(const Vec3& pos, const Quat& rot, Type type)
 	entry->pos = pos;
 	entry->rot = rot;
 	entry->timer = SHELL_CASING_LIFETIME;
-	Vec3 size = shell_casing_size(type);
-	entry->btShape = new btBoxShape(size);
-	btVector3 localInertia(0, 0, 0);
-	const r32 mass = 0.01f;
-	if (mass > 0.0f)
-		entry->btShape->calculateLocalInertia(mass, localInertia);
-
-	btRigidBody::btRigidBodyConstructionInfo info(mass, 0, entry->btShape, localInertia);
-
-	info.m_startWorldTransform = btTransform(entry->rot, entry->pos);
-	entry->btBody = new btRigidBody(info);
-	entry->btBody->setWorldTransform(btTransform(entry->rot, entry->pos));
-
-	entry->btBody->setRestitution(1.0f);
-	entry->btBody->setUserIndex(-1);
-	entry->btBody->setCcdMotionThreshold(size.x);
-	entry->btBody->setCcdSweptSphereRadius(size.z);
-
-	entry->btBody->setLinearVelocity(rot * Vec3(-0.707f * 4.0f, 0.707f * 4.0f + mersenne::randf_cc() - 0.5f, 0));
-	entry->btBody->setAngularVelocity(btVector3((mersenne::randf_cc() - 0.5f) * 2.0f, (mersenne::randf_cc() - 0.5f) * 2.0f, (mersenne::randf_cc() - 0.5f) * 2.0f));
 
-	Physics::btWorld->addRigidBody(entry->btBody, CollisionDroneIgnore, CollisionStatic);
+	Debris::Def def;
+	def.pos = pos;
+	def.rot = rot;
+	def.velocity = rot * Vec3(-0.707f * 4.0f, 0.707f * 4.0f + mersenne::randf_cc() - 0.5f, 0);
+	def.angular_velocity = Vec3((mersenne::randf_cc() - 0.5f) * 2.0f, (mersenne::randf_cc() - 0.5f) * 2.0f, (mersenne::randf_cc() - 0.5f) * 2.0f);
+	def.radius = shell_casing_size(type).x;
+	def.restitution = 1.0f;
+	def.damping = 0.0f;
+	def.mask = CollisionStatic;
+	def.flat = false;
+	entry->debris = Debris::add(def);
 }
 
 void ShellCasing::sync_physics()
@@ -3836,15 +4090,13 @@ void ShellCasing::sync_physics()
 	for (s32 i = 0; i < list.length; i++)
 	{
 		ShellCasing* s = &list[i];
-		btTransform transform = s->btBody->getInterpolationWorldTransform();
-		s->pos = transform.getOrigin();
-		s->rot = transform.getRotation();
+		Debris::get(s->debris, &s->pos, &s->rot);
 	}
 }
 
 void ShellCasing::update_all(const Update& u)
 {
-	// rigid body transforms are synced in Physics::sync_dynamic()
+	// transforms are synced from the debris pool right after Debris::update()
 
 	if (list.length > 0)
 	{
@@ -3854,7 +4106,10 @@ void ShellCasing::update_all(const Update& u)
 			{
 				ShellCasing* s = &list[i];
 				s->timer -= u.time.delta;
-				if (s->timer < 0.0f)
+				Vec3 pos;
+				Quat rot;
+				if (s->timer < 0.0f
+					|| !Debris::get(s->debris, &pos, &rot)) // evicted to make room for newer debris
 				{
 					s->cleanup();
 					list.remove(i);
@@ -3876,9 +4131,7 @@ void ShellCasing::clear()
 
 void ShellCasing::cleanup()
 {
-	Physics::btWorld->removeRigidBody(btBody);
-	delete btBody;
-	delete btShape;
+	Debris::remove(debris);
 }
 
 Array<InstanceVertex> ShellCasing::instances;
@@ -3965,7 +4218,7 @@ GrenadeEntity::GrenadeEntity(PlayerManager* owner, const Vec3& abs_pos, const Ve
 	g->owner = owner;
 	g->velocity = dir * GRENADE_LAUNCH_SPEED;
 
-	create<RigidBody>(RigidBody::Type::Sphere, Vec3(GRENADE_RADIUS * 2.0f), 0.0f, CollisionTarget, ~CollisionParkour & ~CollisionElectric & ~CollisionStatic & ~CollisionAudio & ~CollisionInaccessible & ~CollisionAllTeamsForceField & ~CollisionWalker & ~CollisionMinionMoving & ~CollisionGlass);
+	create<RigidBody>(RigidBody::Type::Sphere, Vec3(GRENADE_RADIUS * 2.0f), 0.0f, CollisionTarget, GRENADE_COLLISION_FILTER);
 
 	PointLight* light = create<PointLight>();
 	light->radius = BOLT_LIGHT_RADIUS;
@@ -2,6 +2,7 @@
 
 #include "data/entity.h"
 #include "ai.h"
+#include "debris.h"
 #include <bullet/src/btBulletDynamicsCommon.h>
 
 namespace VI
@@ -282,11 +283,10 @@ struct GlassShard
 	static void draw_all(const RenderParams&);
 	static void sync_physics();
 
-	btCollisionShape* btShape;
-	btRigidBody* btBody;
 	Quat rot;
 	Vec3 pos;
 	r32 timestamp;
+	Debris::Handle debris;
 	AssetID mesh_id;
 
 	void cleanup();
@@ -499,6 +499,7 @@ struct Bolt : public ComponentType<Bolt>
 	static void update_client_all(const Update&);
 	static b8 default_raycast_filter(Entity*, AI::Team);
 	static b8 raycast(const Vec3&, const Vec3&, s16, AI::Team, Hit*, b8(*)(Entity*, AI::Team), const Net::StateFrame* = nullptr, r32 = 0.0f);
+	static void simulate_all(r32); // server only. same results in the same order as calling simulate on each bolt
 	
 	Vec3 velocity;
 	Vec3 last_pos;
@@ -633,11 +634,10 @@ struct ShellCasing
 	static void draw_all(const RenderParams&);
 	static void sync_physics();
 
-	btRigidBody* btBody;
-	btBoxShape* btShape;
 	Quat rot;
 	Vec3 pos;
 	r32 timer;
+	Debris::Handle debris;
 	Type type;
 
 	void cleanup();
@@ -41,8 +41,12 @@
 #include "ai_player.h"
 #include "usernames.h"
 #include "net.h"
+#include "tick.h"
+#include "benchmark.h"
 #include "parkour.h"
 #include "overworld.h"
+#include "debris.h"
+#include "static_world.h"
 #include "team.h"
 #include "load.h"
 #include <dirent.h>
@@ -426,6 +430,8 @@ void Game::auth_failed()
 
 void Game::update(InputState* input, const InputState* last_input)
 {
+	Benchmark::lap(Benchmark::System::Loop);
+
 #if !SERVER && !defined(__ORBIS__)
 	Discord_UpdateConnection();
 	Discord_RunCallbacks();
@@ -451,6 +457,8 @@ void Game::update(InputState* input, const InputState* last_input)
 		r64 t = platform::time();
 		r64 dt = vi_min(t - platform_time, 0.2);
 		platform_time = t;
+		if (Benchmark::active())
+			dt = Net::tick_rate(); // simulate at a fixed rate regardless of how fast we're running
 
 		real_time.total = r32(r64(real_time.total) + dt);
 		real_time.delta = r32(dt);
@@ -516,6 +524,8 @@ void Game::update(InputState* input, const InputState* last_input)
 
 	Net::update_start(u);
 
+	Benchmark::lap(Benchmark::System::Net);
+
 #if !SERVER
 	// trigger attract mode
 	if (Settings::expo && Net::Client::replay_mode() != Net::Client::ReplayMode::Replaying)
@@ -619,14 +629,25 @@ void Game::update(InputState* input, const InputState* last_input)
 
 	AI::update(u);
 
+	Benchmark::lap(Benchmark::System::AI);
+
 	Team::update_all(u);
 
+	Benchmark::lap(Benchmark::System::Team);
+
 	if (update_game)
 	{
 		Ascensions::update(u);
 		Asteroids::update(u);
 
+		Benchmark::lap(Benchmark::System::Other);
+
 		Physics::sync_dynamic();
+		Debris::update(u.time.delta);
+		ShellCasing::sync_physics();
+		GlassShard::sync_physics();
+
+		Benchmark::lap(Benchmark::System::Physics);
 
 		ShellCasing::update_all(u);
 
@@ -647,13 +668,19 @@ void Game::update(InputState* input, const InputState* last_input)
 		for (auto i = TramRunner::list.iterator(); !i.is_last(); i.next())
 			i.item()->update(u);
 
+		Benchmark::lap(Benchmark::System::Animation);
+
 		Physics::sync_static();
 
+		Benchmark::lap(Benchmark::System::Physics);
+
 		ParticleEffect::update_all(u);
 
 		PlayerManager::update_all(u);
 		PlayerHuman::update_all(u);
 
+		Benchmark::lap(Benchmark::System::Other);
+
 		if (level.local)
 		{
 			if (session.type == SessionType::Story && level.mode == Mode::Pvp && Team::match_state != Team::MatchState::Done)
@@ -680,14 +707,18 @@ void Game::update(InputState* input, const InputState* last_input)
 				}
 			}
 
+			Benchmark::lap(Benchmark::System::Bots);
+
 			for (auto i = Walker::list.iterator(); !i.is_last(); i.next())
 				i.item()->update_server(u);
+			Benchmark::lap(Benchmark::System::Walkers);
 			for (auto i = PlayerAI::list.iterator(); !i.is_last(); i.next())
 				i.item()->update_server(u);
 			for (auto i = PlayerControlAI::list.iterator(); !i.is_last(); i.next())
 				i.item()->update_server(u);
-			for (auto i = Bolt::list.iterator(); !i.is_last(); i.next())
-				i.item()->simulate(u.time.delta);
+			Benchmark::lap(Benchmark::System::Bots);
+			Bolt::simulate_all(u.time.delta);
+			Benchmark::lap(Benchmark::System::Projectiles);
 			for (auto i = Flag::list.iterator(); !i.is_last(); i.next())
 				i.item()->update_server(u);
 		}
@@ -703,20 +734,27 @@ void Game::update(InputState* input, const InputState* last_input)
 		Bolt::update_client_all(u);
 #endif
 
+		Benchmark::lap(Benchmark::System::Other);
+
 		MinionSpawner::update_all(u);
 		Turret::update_all(u);
 
 		for (auto i = Health::list.iterator(); !i.is_last(); i.next())
 			i.item()->update(u);
+		Benchmark::lap(Benchmark::System::Other);
 		Minion::update_all(u);
+		Benchmark::lap(Benchmark::System::Minions);
 		Grenade::update_all(u);
+		Benchmark::lap(Benchmark::System::Projectiles);
 		for (auto i = Tile::list.iterator(); !i.is_last(); i.next())
 			i.item()->update(u);
 		for (auto i = AirWave::list.iterator(); !i.is_last(); i.next())
 			i.item()->update(u);
 		for (auto i = UpgradeStation::list.iterator(); !i.is_last(); i.next())
 			i.item()->update(u);
+		Benchmark::lap(Benchmark::System::Other);
 		Drone::update_all(u);
+		Benchmark::lap(Benchmark::System::Drones);
 		for (auto i = PlayerTrigger::list.iterator(); !i.is_last(); i.next())
 			i.item()->update(u);
 		Battery::update_all(u);
@@ -776,6 +814,8 @@ void Game::update(InputState* input, const InputState* last_input)
 
 	Overworld::update(u);
 
+	Benchmark::update();
+
 	World::flush();
 
 	Audio::param_global(AK::GAME_PARAMETERS::TIMESCALE, session.effective_time_scale());
@@ -785,8 +825,12 @@ void Game::update(InputState* input, const InputState* last_input)
 	Menu::update_end(u);
 #endif
 
+	Benchmark::lap(Benchmark::System::Other);
+
 	Net::update_end(u);
 
+	Benchmark::lap(Benchmark::System::Net);
+
 	u.input->cursor_visible = UI::cursor_active();
 }
 
@@ -1323,6 +1367,10 @@ void Game::execute(const char* cmd)
 {
 	if (strcmp(cmd, "netstat") == 0)
 		Net::show_stats = !Net::show_stats;
+	else if (strcmp(cmd, "netstat dump") == 0)
+		Net::stats_dump("netstats.json");
+	else if (strcmp(cmd, "tick dump") == 0)
+		Tick::dump("ticks.json");
 #if !SERVER
 	else if (strstr(cmd, "replay") == cmd)
 	{
@@ -1502,9 +1550,10 @@ void Game::schedule_load_level(AssetID level_id, Mode m, r32 delay)
 	scheduled_load_level = level_id;
 	scheduled_mode = m;
 	schedule_timer = TRANSITION_TIME + delay;
+	Loader::level_prefetch(level_id, session.config.game_type);
 }
 
-void Game::unload_level()
+void Game::unload_level(b8 reloading)
 {
 	vi_debug("Unloading level %d", s32(level.id));
 	Net::reset();
@@ -1534,11 +1583,13 @@ void Game::unload_level()
 	Particles::clear();
 	Rain::audio_clear();
 	ShellCasing::clear();
+	Debris::clear();
 	ParticleEffect::clear();
 
 	Audio::clear();
 
-	Loader::transients_free();
+	Physics::shape_cache_purge(reloading); // before the meshes they point to are freed
+	Loader::transients_free(reloading);
 	updates.length = 0;
 	draws.length = 0;
 	for (s32 i = 0; i < cleanups.length; i++)
@@ -1623,10 +1674,15 @@ cJSON* json_entity_by_name(cJSON* json, const char* name)
 void Game::load_level(AssetID l, Mode m, StoryModeTeam story_mode_team)
 {
 	vi_debug("Loading level %d", s32(l));
+	r64 load_start = platform::time();
+	r64 mesh_shape_time_start = Physics::stats.mesh_shape_time;
+	u32 mesh_shapes_loaded_start = Physics::stats.mesh_shapes_loaded;
+	u32 mesh_shapes_built_start = Physics::stats.mesh_shapes_built;
 
 	AssetID last_level = level.id;
 	Mode last_mode = level.mode;
-	unload_level();
+	b8 reloading = l != AssetNull && l == last_level;
+	unload_level(reloading); // on a rematch, keep the meshes and (on the server) the parsed level around
 
 	{
 		// start abilities may not show up in the default upgrades
@@ -1878,18 +1934,18 @@ void Game::load_level(AssetID l, Mode m, StoryModeTeam story_mode_team)
 					{
 						// inaccessible
 						if (no_parkour) // no parkour material
-							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, CollisionInaccessible | extra_collision);
+							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, CollisionInaccessible | extra_collision, ~CollisionStatic & ~CollisionAudio, RigidBody::FlagStaticWorld);
 						else
-							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, CollisionParkour | CollisionInaccessible | extra_collision);
+							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, CollisionParkour | CollisionInaccessible | extra_collision, ~CollisionStatic & ~CollisionAudio, RigidBody::FlagStaticWorld);
 						m->get<View>()->color.w = MATERIAL_INACCESSIBLE;
 					}
 					else
 					{
 						// accessible
 						if (no_parkour) // no parkour material
-							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, extra_collision);
+							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, extra_collision, ~CollisionStatic & ~CollisionAudio, RigidBody::FlagStaticWorld);
 						else
-							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, CollisionParkour | extra_collision);
+							m = World::alloc<StaticGeom>(mesh_id, absolute_pos, absolute_rot, CollisionParkour | extra_collision, ~CollisionStatic & ~CollisionAudio, RigidBody::FlagStaticWorld);
 					}
 
 					m->get<View>()->texture = texture;
@@ -1953,7 +2009,7 @@ void Game::load_level(AssetID l, Mode m, StoryModeTeam story_mode_team)
 			if (session.config.game_type == GameType::Assault && s32(team) >= Team::list.count())
 			{
 				// no spawn point
-				entity = World::alloc<StaticGeom>(Asset::Mesh::spawn_collision, absolute_pos, absolute_rot, CollisionParkour, ~CollisionParkour & ~CollisionInaccessible & ~CollisionElectric);
+				entity = World::alloc<StaticGeom>(Asset::Mesh::spawn_collision, absolute_pos, absolute_rot, CollisionParkour, ~CollisionParkour & ~CollisionInaccessible & ~CollisionElectric, RigidBody::FlagStaticWorld);
 				entity->get<View>()->mesh = Asset::Mesh::spawn_dressing;
 			}
 			else
@@ -2499,6 +2555,7 @@ void Game::load_level(AssetID l, Mode m, StoryModeTeam story_mode_team)
 		World::awake(level.finder.map[i].entity.ref());
 
 	Physics::sync_static();
+	StaticWorld::build();
 
 	for (s32 i = 0; i < ropes.length; i++)
 	{
@@ -2648,6 +2705,14 @@ void Game::awake_all()
 
 	Loader::nav_mesh(level.id, session.config.game_type);
 
+	vi_debug("Level %d %s in %.1fms. %u mesh collision BVHs loaded, %u built, %.1fms creating mesh shapes.",
+		s32(l),
+		reloading ? "reloaded" : "loaded",
+		(platform::time() - load_start) * 1000.0,
+		Physics::stats.mesh_shapes_loaded - mesh_shapes_loaded_start,
+		Physics::stats.mesh_shapes_built - mesh_shapes_built_start,
+		(Physics::stats.mesh_shape_time - mesh_shape_time_start) * 1000.0);
+
 #if !SERVER && !defined(__ORBIS__)
 	discord_update_presence();
 #endif
@@ -224,7 +224,7 @@ struct Game
 	static void execute(const char*);
 	static void update(InputState*, const InputState*);
 	static void schedule_load_level(AssetID, Mode, r32 = 0.0f);
-	static void unload_level();
+	static void unload_level(b8 = false); // true if the same level is about to be loaded again
 	static void load_level(AssetID, Mode, StoryModeTeam = StoryModeTeam::Attack);
 	static void awake_all();
 	static void draw_opaque(const RenderParams&);
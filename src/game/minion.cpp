@@ -838,13 +838,11 @@ void Minion::killed(Entity* killer)
 	}
 }
 
-b8 minion_vision_check(AI::Team team, const Vec3& start, const Vec3& end, Entity* target, b8 check_force_fields)
+b8 minion_vision_hit(const RaycastHit& ray_hit, Entity* target)
 {
-	btCollisionWorld::ClosestRayResultCallback ray_callback(start, end);
-	Physics::raycast(&ray_callback, (CollisionStatic | CollisionInaccessible | CollisionElectric | CollisionParkour | (check_force_fields ? CollisionAllTeamsForceField : 0)) & ~Team::force_field_mask(team));
-	if (ray_callback.hasHit())
+	if (ray_hit.object)
 	{
-		Entity* hit = &Entity::list[ray_callback.m_collisionObject->getUserIndex()];
+		Entity* hit = &Entity::list[ray_hit.object->getUserIndex()];
 		if (hit->has<ForceFieldCollision>())
 			hit = hit->get<ForceFieldCollision>()->field.ref()->entity();
 		return target == hit;
@@ -877,12 +875,24 @@ b8 Minion::can_see(Entity* target, b8 limit_vision_cone, b8 check_force_fields)
 	if (limit_vision_cone && target->has<Parkour>() && distance < MINION_HEARING_RANGE)
 		limit_vision_cone = false;
 
-	return distance < MINION_VISION_RANGE
+	if (distance < MINION_VISION_RANGE
 		&& (!limit_vision_cone || Vec3::normalize(diff).dot(get<Walker>()->forward()) > 0.707f)
 		&& (!target->has<Parkour>() || fabsf(diff.y) < MINION_HEARING_RANGE)
-		&& minion_vision_check(get<AIAgent>()->team, head, target_pos, target, check_force_fields)
-		&& minion_vision_check(get<AIAgent>()->team, hand, target_pos, target, check_force_fields)
-		&& (!has_grenade() || (aim_pos(get<Walker>()->rotation) - target_pos).length_squared() < MINION_MELEE_RANGE * MINION_MELEE_RANGE); // can only melee if holding a grenade
+		&& (!has_grenade() || (aim_pos(get<Walker>()->rotation) - target_pos).length_squared() < MINION_MELEE_RANGE * MINION_MELEE_RANGE)) // can only melee if holding a grenade
+	{
+		// line of sight from both the head and the hand
+		s16 mask = (CollisionStatic | CollisionInaccessible | CollisionElectric | CollisionParkour | (check_force_fields ? CollisionAllTeamsForceField : 0)) & ~Team::force_field_mask(get<AIAgent>()->team);
+		Raycast rays[2] =
+		{
+			{ head, target_pos, IDNull, mask },
+			{ hand, target_pos, IDNull, mask },
+		};
+		RaycastHit hits[2];
+		Physics::raycast_batch(rays, hits, 2);
+		return minion_vision_hit(hits[0], target) && minion_vision_hit(hits[1], target);
+	}
+
+	return false;
 }
 
 void Minion::new_goal()
@@ -20,6 +20,9 @@
 #include "overworld.h"
 #include "player.h"
 #include "common.h"
+#include "benchmark.h"
+#include "shed.h"
+#include "load.h"
 
 namespace VI
 {
@@ -497,7 +500,17 @@ Team* Team::with_most_energy_collected()
 	return result;
 }
 
-b8 visibility_check(Entity* i, Entity* j, r32 i_range)
+struct VisibilityBatch
+{
+	Raycast rays[MAX_PLAYERS * MAX_PLAYERS];
+	RaycastHit hits[MAX_PLAYERS * MAX_PLAYERS];
+	PlayerManager::Visibility* entries[MAX_PLAYERS * MAX_PLAYERS];
+	const LevelPvs* pvs;
+	s32 count;
+};
+
+// either settles visibility right away, or queues a raycast to settle it
+void visibility_check(VisibilityBatch* batch, PlayerManager::Visibility* visibility, Entity* i, Entity* j, r32 i_range)
 {
 	Vec3 start = i->get<Transform>()->absolute_pos();
 	Vec3 end = j->get<Transform>()->absolute_pos();
@@ -505,16 +518,20 @@ b8 visibility_check(Entity* i, Entity* j, r32 i_range)
 
 	r32 dist_sq = diff.length_squared();
 	if (btFuzzyZero(dist_sq))
-		return true;
+		visibility->value = true;
 	else if (dist_sq < i_range * i_range)
 	{
-		btCollisionWorld::ClosestRayResultCallback ray_callback(start, end);
-		Physics::raycast(&ray_callback, CollisionAudio);
-		if (!ray_callback.hasHit())
-			return true;
+		if (batch->pvs && batch->pvs->blocked(start, end))
+			visibility->value = false; // the ray would definitely hit something
+		else
+		{
+			batch->rays[batch->count] = { start, end, IDNull, CollisionAudio };
+			batch->entries[batch->count] = visibility;
+			batch->count++;
+		}
 	}
-
-	return false;
+	else
+		visibility->value = false;
 }
 
 // determine which rectifiers can see the given player
@@ -541,9 +558,26 @@ void get_rectifier_visibility(b8 visibility[MAX_TEAMS], Entity* player_entity)
 	}
 }
 
+#define VISIBILITY_INTERVAL_SHED 0.2f // how often visibility is refreshed when the server is shedding load
+
+static r32 visibility_timer;
+
 void update_visibility(const Update& u)
 {
-	// update player visibility
+	if (Shed::active(Shed::Level::Visibility))
+	{
+		visibility_timer -= u.time.delta;
+		if (visibility_timer > 0.0f)
+			return;
+		visibility_timer = VISIBILITY_INTERVAL_SHED;
+	}
+	else
+		visibility_timer = 0.0f;
+
+	// update player visibility. line of sight checks are collected and raycast in one batch
+	VisibilityBatch batch;
+	batch.pvs = Loader::level_pvs(Game::level.id);
+	batch.count = 0;
 	for (auto i = PlayerManager::list.iterator(); !i.is_last(); i.next())
 	{
 		Entity* i_entity = i.item()->instance.ref();
@@ -567,12 +601,16 @@ void update_visibility(const Update& u)
 			{
 				Entity* j_entity = j.item()->instance.ref();
 				if (j_entity)
-					visibility->value = visibility_check(i_entity, j_entity, i_range);
+					visibility_check(&batch, visibility, i_entity, j_entity, i_range);
 				else
 					visibility->value = false;
 			}
 		}
 	}
+
+	Physics::raycast_batch(batch.rays, batch.hits, batch.count);
+	for (s32 i = 0; i < batch.count; i++)
+		batch.entries[i]->value = !batch.hits[i].object;
 }
 
 namespace TeamNet
@@ -882,7 +920,8 @@ void Team::update_all_server(const Update& u)
 	{
 		// check whether we need to transition to TeamSelect
 		if (Game::session.type == SessionType::Story
-			|| PlayerHuman::list.count() >= vi_max(s32(Game::session.config.min_players), Game::session.config.fill_bots ? 1 : 2))
+			|| PlayerHuman::list.count() >= vi_max(s32(Game::session.config.min_players), Game::session.config.fill_bots ? 1 : 2)
+			|| Benchmark::active())
 			match_team_select();
 	}
 	else if (match_state == MatchState::TeamSelect)
@@ -890,7 +929,8 @@ void Team::update_all_server(const Update& u)
 		// check whether we need to transition back to Waiting
 		if (Game::session.type == SessionType::Multiplayer
 			&& Game::scheduled_load_level == AssetNull
-			&& PlayerHuman::list.count() < vi_max(s32(Game::session.config.min_players), Game::session.config.fill_bots ? 1 : 2))
+			&& PlayerHuman::list.count() < vi_max(s32(Game::session.config.min_players), Game::session.config.fill_bots ? 1 : 2)
+			&& !Benchmark::active())
 		{
 			if (Game::session.config.time_limit_parkour_ready > 0) // go back to parkour mode
 			{
@@ -957,7 +997,7 @@ void Team::update_all_server(const Update& u)
 	if ((match_state == MatchState::Waiting || match_state == MatchState::TeamSelect || match_state == MatchState::Active)
 		&& Game::level.mode == Game::Mode::Pvp
 		&& Game::session.config.fill_bots
-		&& PlayerHuman::list.count() > 0)
+		&& (PlayerHuman::list.count() > 0 || Benchmark::active())) // benchmarks are all bots
 	{
 		while (PlayerManager::list.count() < vi_min(s32(Game::session.config.max_players), Game::session.config.fill_bots + 1))
 		{
@@ -1057,6 +1097,9 @@ void Team::update_all_server(const Update& u)
 					TeamNet::update_counts(i.item());
 				TeamNet::send_match_state(MatchState::Done, w);
 
+				if (Game::session.type == SessionType::Multiplayer)
+					Loader::level_prefetch(Game::level.multiplayer_level_scheduled, Game::session.config.game_type); // decode the next level while everyone looks at the scores
+
 				if (Game::session.type == SessionType::Story)
 				{
 					// we're in story mode, give the player whatever stuff they have leftover
@@ -8,6 +8,7 @@
 #include "team.h"
 #include "minion.h"
 #include "parkour.h"
+#include "static_world.h"
 
 namespace VI
 {
@@ -17,6 +18,9 @@ namespace VI
 #define ACCEL2 3.0f
 #define DECELERATION 30.0f
 
+u64 Walker::support_queries;
+u64 Walker::support_cache_hits;
+
 void walker_set_rigid_body_props(btRigidBody* btBody)
 {
 	btBody->setFriction(0);
@@ -36,7 +40,8 @@ Walker::Walker(r32 rot)
 	enabled(true),
 	land(),
 	net_speed_timer(),
-	net_speed()
+	net_speed(),
+	support_cache()
 {
 }
 
@@ -107,17 +112,25 @@ const btRigidBody* get_actual_support_body(const btRigidBody* object)
 		return object;
 }
 
-btCollisionWorld::ClosestRayResultCallback Walker::check_support(r32 extra_distance) const
+s16 support_mask(const Walker* w)
 {
-	Vec3 pos = get<Transform>()->absolute_pos();
+	return ~CollisionDroneIgnore & ~CollisionWalker & ~CollisionMinionMoving & ~CollisionTarget & ~Team::force_field_mask(w->get<AIAgent>()->team);
+}
+
+Vec3 support_ray(const Walker* w, r32 extra_distance)
+{
+	return Vec3(0, (w->capsule_height() * -0.5f) + (WALKER_SUPPORT_HEIGHT * -1.5f) - extra_distance, 0);
+}
 
-	for (s32 i = 0; i < num_corners; i++)
+btCollisionWorld::ClosestRayResultCallback support_corners(const Walker* w, const Vec3& pos, r32 extra_distance, s32 first_corner)
+{
+	for (s32 i = first_corner; i < num_corners; i++)
 	{
-		Vec3 ray_start = pos + (corners[i] * (radius() * 0.75f));
-		Vec3 ray_end = ray_start + Vec3(0, (capsule_height() * -0.5f) + (WALKER_SUPPORT_HEIGHT * -1.5f) - extra_distance, 0);
+		Vec3 ray_start = pos + (corners[i] * (w->radius() * 0.75f));
+		Vec3 ray_end = ray_start + support_ray(w, extra_distance);
 
 		btCollisionWorld::ClosestRayResultCallback ray_callback(ray_start, ray_end);
-		Physics::raycast(&ray_callback, ~CollisionDroneIgnore & ~CollisionWalker & ~CollisionMinionMoving & ~CollisionTarget & ~Team::force_field_mask(get<AIAgent>()->team));
+		Physics::raycast(&ray_callback, support_mask(w));
 		if (ray_callback.hasHit())
 		{
 			ray_callback.m_collisionObject = get_actual_support_body((const btRigidBody*)(ray_callback.m_collisionObject));
@@ -129,6 +142,54 @@ btCollisionWorld::ClosestRayResultCallback Walker::check_support(r32 extra_dista
 	return btCollisionWorld::ClosestRayResultCallback(Vec3::zero, Vec3::zero);
 }
 
+btCollisionWorld::ClosestRayResultCallback Walker::check_support(r32 extra_distance) const
+{
+	return support_corners(this, get<Transform>()->absolute_pos(), extra_distance, 0);
+}
+
+// same result as check_support(). while the center ray stays inside the column the cache was gathered for,
+// it only tests the static world leaves in that column instead of walking the whole tree. bodies outside the static world are always raycast
+btCollisionWorld::ClosestRayResultCallback Walker::check_support_cached()
+{
+	Vec3 pos = get<Transform>()->absolute_pos();
+	Vec3 ray_end = pos + support_ray(this, 0.0f); // center ray; corners[0] is the origin
+
+	StaticWorld::update();
+
+	btCollisionWorld::ClosestRayResultCallback ray_callback(pos, ray_end);
+	const SupportCache& cache = support_cache;
+	if (cache.valid
+		&& cache.static_world_revision == StaticWorld::revision()
+		&& pos.x >= cache.bounds_min.x && pos.x <= cache.bounds_max.x
+		&& pos.z >= cache.bounds_min.z && pos.z <= cache.bounds_max.z
+		&& pos.y <= cache.bounds_max.y && ray_end.y >= cache.bounds_min.y)
+	{
+		support_cache_hits++;
+		Physics::raycast_outside_static_world(&ray_callback, support_mask(this)); // also sets up the callback's flags and mask
+		StaticWorld::raycast_leaves(cache.leaves.data, cache.leaves.length, pos, ray_end, &ray_callback);
+	}
+	else
+	{
+		support_queries++;
+		Physics::raycast(&ray_callback, support_mask(this));
+
+		// gather the column around the walker for next time
+		support_cache.bounds_min = Vec3(pos.x - WALKER_SUPPORT_CACHE_RADIUS, ray_end.y - WALKER_SUPPORT_CACHE_MARGIN, pos.z - WALKER_SUPPORT_CACHE_RADIUS);
+		support_cache.bounds_max = Vec3(pos.x + WALKER_SUPPORT_CACHE_RADIUS, pos.y + WALKER_SUPPORT_CACHE_MARGIN, pos.z + WALKER_SUPPORT_CACHE_RADIUS);
+		support_cache.leaves.resize(WALKER_SUPPORT_CACHE_LEAVES);
+		s32 count = StaticWorld::leaves(support_cache.bounds_min, support_cache.bounds_max, support_cache.leaves.data, WALKER_SUPPORT_CACHE_LEAVES);
+		support_cache.valid = count >= 0; // too much geometry around here; keep raycasting the whole tree
+		support_cache.leaves.resize(vi_max(count, 0));
+		support_cache.static_world_revision = StaticWorld::revision();
+	}
+
+	if (!ray_callback.hasHit())
+		return support_corners(this, pos, 0.0f, 1);
+
+	ray_callback.m_collisionObject = get_actual_support_body((const btRigidBody*)(ray_callback.m_collisionObject));
+	return ray_callback;
+}
+
 RigidBody* Walker::get_support(r32 extra_distance) const
 {
 	btCollisionWorld::ClosestRayResultCallback ray_callback = check_support(extra_distance);
@@ -187,7 +248,7 @@ void Walker::update_server(const Update& u)
 		Vec3 support_velocity = Vec3::zero;
 		Vec3 adjustment = Vec3::zero;
 
-		btCollisionWorld::ClosestRayResultCallback ray_callback = check_support();
+		btCollisionWorld::ClosestRayResultCallback ray_callback = check_support_cached();
 
 		if (ray_callback.hasHit())
 		{
@@ -14,9 +14,26 @@ struct RigidBody;
 #define WALKER_PARKOUR_RADIUS 0.45f
 #define WALKER_MINION_RADIUS 0.35f
 #define WALKER_TRACTION_DOT 0.7f
+#define WALKER_SUPPORT_CACHE_RADIUS 1.5f // horizontal half-size of the column a walker can move around in before its support cache is gathered again
+#define WALKER_SUPPORT_CACHE_MARGIN 0.5f // vertical slack above and below the support ray
+#define WALKER_SUPPORT_CACHE_LEAVES 16
 
 struct Walker : public ComponentType<Walker>
 {
+	// static world leaves in a column around where the center support ray was last cast in full.
+	// any ray inside the column can only hit level geometry in these leaves
+	struct SupportCache
+	{
+		StaticArray<s32, WALKER_SUPPORT_CACHE_LEAVES> leaves;
+		Vec3 bounds_min;
+		Vec3 bounds_max;
+		u32 static_world_revision;
+		b8 valid;
+	};
+
+	static u64 support_queries; // support checks that raycast the whole static world
+	static u64 support_cache_hits; // support checks that only tested their cached leaves
+
 	static Vec3 get_support_velocity(const Vec3&, const btCollisionObject*);
 
 	Vec2 dir;
@@ -27,6 +44,7 @@ struct Walker : public ComponentType<Walker>
 		net_speed,
 		net_speed_timer;
 	Ref<RigidBody> support;
+	SupportCache support_cache;
 	LinkArg<r32> land;
 	b8 auto_rotate;
 	b8 enabled;
@@ -35,6 +53,7 @@ struct Walker : public ComponentType<Walker>
 	void awake();
 	b8 slide(Vec2*, const Vec3&);
 	btCollisionWorld::ClosestRayResultCallback check_support(r32 = 0.0f) const;
+	btCollisionWorld::ClosestRayResultCallback check_support_cached();
 	RigidBody* get_support(r32 = 0.0f) const;
 
 	Vec3 base_pos() const;
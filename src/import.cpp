@@ -35,6 +35,8 @@
 #include "render/glvm.h"
 #include "cjson/cJSON.h"
 #include "data/json.h"
+#include "bullet/src/BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "bullet/src/BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
 
 namespace VI
 {
@@ -234,16 +236,18 @@ namespace platform
 
 typedef Chunks<Array<Vec3>> ChunkedTris;
 
-const s32 version = 38;
+const s32 version = 40;
 
 const char* model_in_extension = ".blend";
 const char* model_intermediate_extension = ".fbx";
 const char* mesh_out_extension = ".msh";
+const char* mesh_bvh_out_extension = ".bvh";
 const char* font_in_extension = ".ttf";
 const char* font_in_extension_2 = ".otf"; // Must be same length
 const char* font_out_extension = ".fnt";
 const char* soundbank_extension = ".bnk";
 const char* nav_mesh_out_extension = ".nav";
+const char* pvs_out_extension = ".pvs";
 const char* anim_out_extension = ".anm";
 const char* arm_out_extension = ".arm";
 const char* texture_extension = ".png";
@@ -1347,6 +1351,38 @@ b8 write_mesh(
 		return false;
 }
 
+// build the collision BVH the same way RigidBody::awake would, and save it so the game doesn't have to
+b8 write_mesh_bvh(const Mesh* mesh, const std::string& path)
+{
+	btTriangleIndexVertexArray mesh_interface(mesh->indices.length / 3, mesh->indices.data, 3 * sizeof(s32), mesh->vertices.length, (btScalar*)mesh->vertices.data, sizeof(Vec3));
+	btBvhTriangleMeshShape shape(&mesh_interface, true, mesh->bounds_min, mesh->bounds_max);
+	const btOptimizedBvh* bvh = shape.getOptimizedBvh();
+
+	MeshBvhHeader header;
+	header.version = MESH_BVH_VERSION;
+	header.scalar_size = sizeof(btScalar);
+	header.vertex_count = mesh->vertices.length;
+	header.index_count = mesh->indices.length;
+	header.size = bvh->calculateSerializeBufferSize();
+
+	void* buffer = btAlignedAlloc(header.size, 16);
+	b8 success = bvh->serializeInPlace(buffer, header.size, false);
+	if (success)
+	{
+		FILE* f = fopen(path.c_str(), "w+b");
+		if (f)
+		{
+			fwrite(&header, sizeof(MeshBvhHeader), 1, f);
+			fwrite(buffer, 1, header.size, f);
+			fclose(f);
+		}
+		else
+			success = false;
+	}
+	btAlignedFree(buffer);
+	return success;
+}
+
 b8 import_meshes(ImporterState& state, const std::string& asset_in_path, const std::string& out_folder, Array<Mesh>& meshes, b8 force_rebuild, b8 tangents = false)
 {
 	std::string asset_name = get_asset_name(asset_in_path);
@@ -1678,6 +1714,17 @@ b8 import_level_meshes(ImporterState& state, const std::string& asset_in_path, c
 					state.error = true;
 					return false;
 				}
+
+				if (mesh->indices.length > 0)
+				{
+					std::string bvh_out_filename = out_folder + mesh_name + mesh_bvh_out_extension;
+					if (!write_mesh_bvh(mesh, bvh_out_filename))
+					{
+						fprintf(stderr, "Error: Failed to write BVH file %s.\n", bvh_out_filename.c_str());
+						state.error = true;
+						return false;
+					}
+				}
 			}
 			else
 			{
@@ -3115,6 +3162,311 @@ void build_drone_nav_mesh(Map<Mesh>& meshes, Manifest& manifest, cJSON* json, Dr
 	printf("Built reverb voxel: %fs\n", platform::time() - timer);
 }
 
+// potentially visible set for team visibility. see LevelPvs
+
+const r32 pvs_chunk_size = 4.0f;
+const r32 pvs_range = DRONE_MAX_DISTANCE; // visibility is never raycast further than this, except while sniping
+const r32 pvs_plane_margin = 0.1f; // cells have to be at least this far in front of and behind an occluder
+const r32 pvs_edge_margin = 0.1f; // and every line between them has to cross at least this far inside its edges
+const r32 pvs_occluder_min_area = pvs_chunk_size * pvs_chunk_size * 0.25f;
+
+struct PvsOccluder
+{
+	Vec3 vertices[4]; // convex, counterclockwise around the normal
+	Vec3 edge_normals[4]; // pointing inward
+	Vec3 normal; // rays only hit from this side
+	Vec3 bounds_min;
+	Vec3 bounds_max;
+	r32 d;
+	s32 vertex_count;
+};
+
+// CollisionAudio geometry that is guaranteed to exist at runtime. see Game::load_level
+void consolidate_pvs_geometry(Mesh* result, Map<Mesh>& meshes, Manifest& manifest, cJSON* json)
+{
+	static_meshes.import();
+
+	Array<Mat4> transforms;
+	Array<b8> conditional; // elements that might not spawn, depending on the player and team count
+	cJSON* element = json->child;
+	while (element)
+	{
+		Mat4 mat;
+		{
+			Vec3 pos = Json::get_vec3(element, "pos");
+			Quat rot = Json::get_quat(element, "rot");
+			mat.make_transform(pos, Vec3(1, 1, 1), rot);
+		}
+
+		b8 c = cJSON_HasObjectItem(element, "min_players")
+			|| cJSON_HasObjectItem(element, "max_players")
+			|| cJSON_HasObjectItem(element, "min_teams")
+			|| cJSON_HasObjectItem(element, "max_teams");
+
+		s32 parent = Json::get_s32(element, "parent", -1);
+		if (parent != -1)
+		{
+			mat = mat * transforms[parent];
+			c |= conditional[parent];
+		}
+
+		transforms.add(mat);
+		conditional.add(c);
+
+		if (!c && cJSON_HasObjectItem(element, "StaticGeom") && !cJSON_HasObjectItem(element, "nonav"))
+		{
+			cJSON* mesh_refs = cJSON_GetObjectItem(element, "meshes");
+			cJSON* mesh_ref_json = mesh_refs->child;
+			while (mesh_ref_json)
+			{
+				const char* mesh_ref = mesh_ref_json->valuestring;
+
+				const Mesh* mesh;
+				if (map_has(meshes, mesh_ref))
+					mesh = &map_get(meshes, mesh_ref);
+				else
+				{
+					cJSON* asset = cJSON_GetObjectItem(element, "_asset");
+					const char* asset_name;
+					if (asset)
+						asset_name = asset->valuestring;
+					else
+						asset_name = mesh_ref;
+					mesh = static_meshes.get(manifest, asset_name, mesh_ref);
+				}
+
+				vi_assert(mesh);
+
+				consolidate_nav_geometry_mesh(result, *mesh, mat);
+
+				mesh_ref_json = mesh_ref_json->next;
+			}
+		}
+
+		element = element->next;
+	}
+}
+
+void pvs_occluder_add(Array<PvsOccluder>* occluders, const Vec3* vertices, s32 count, const Vec3& normal)
+{
+	PvsOccluder* o = occluders->add();
+	o->vertex_count = count;
+	o->normal = normal;
+	o->d = normal.dot(vertices[0]);
+	o->bounds_min = o->bounds_max = vertices[0];
+	for (s32 i = 0; i < count; i++)
+	{
+		const Vec3& v = vertices[i];
+		o->vertices[i] = v;
+		o->edge_normals[i] = Vec3::normalize(normal.cross(vertices[(i + 1) % count] - v));
+		o->bounds_min = Vec3(vi_min(o->bounds_min.x, v.x), vi_min(o->bounds_min.y, v.y), vi_min(o->bounds_min.z, v.z));
+		o->bounds_max = Vec3(vi_max(o->bounds_max.x, v.x), vi_max(o->bounds_max.y, v.y), vi_max(o->bounds_max.z, v.z));
+	}
+}
+
+inline b8 pvs_vertex_equal(const Vec3& a, const Vec3& b)
+{
+	return (a - b).length_squared() < 0.001f * 0.001f;
+}
+
+// large triangles, plus coplanar pairs of them that form convex quads
+void pvs_occluders(const Mesh& geometry, Array<PvsOccluder>* out)
+{
+	struct Tri
+	{
+		Vec3 v[3];
+		Vec3 normal;
+	};
+
+	Array<Tri> tris;
+	for (s32 i = 0; i < geometry.indices.length; i += 3)
+	{
+		Tri t;
+		t.v[0] = geometry.vertices[geometry.indices[i]];
+		t.v[1] = geometry.vertices[geometry.indices[i + 1]];
+		t.v[2] = geometry.vertices[geometry.indices[i + 2]];
+		t.normal = (t.v[1] - t.v[0]).cross(t.v[2] - t.v[0]); // same winding Bullet uses to filter backfaces
+		r32 area = t.normal.length() * 0.5f;
+		if (area > pvs_occluder_min_area)
+		{
+			t.normal /= area * 2.0f;
+			tris.add(t);
+			pvs_occluder_add(out, t.v, 3, t.normal);
+		}
+	}
+
+	for (s32 i = 0; i < tris.length; i++)
+	{
+		const Tri& a = tris[i];
+		for (s32 j = i + 1; j < tris.length; j++)
+		{
+			const Tri& b = tris[j];
+			if (a.normal.dot(b.normal) < 0.9999f)
+				continue;
+
+			for (s32 ea = 0; ea < 3; ea++)
+			{
+				for (s32 eb = 0; eb < 3; eb++)
+				{
+					const Vec3& x = a.v[ea];
+					const Vec3& y = a.v[(ea + 1) % 3];
+					if (pvs_vertex_equal(x, b.v[(eb + 1) % 3]) && pvs_vertex_equal(y, b.v[eb]))
+					{
+						const Vec3& w = b.v[(eb + 2) % 3];
+						if (fabsf(a.normal.dot(w - x)) > 0.001f)
+							continue; // not coplanar
+
+						Vec3 quad[4] = { x, w, y, a.v[(ea + 2) % 3] };
+						b8 convex = true;
+						for (s32 k = 0; k < 4; k++)
+						{
+							Vec3 turn = (quad[(k + 1) % 4] - quad[k]).cross(quad[(k + 2) % 4] - quad[(k + 1) % 4]);
+							if (turn.dot(a.normal) < 0.0001f)
+							{
+								convex = false;
+								break;
+							}
+						}
+						if (convex)
+							pvs_occluder_add(out, quad, 4, a.normal);
+					}
+				}
+			}
+		}
+	}
+}
+
+// true if every line from box a to box b hits the front of the occluder.
+// a is entirely in front, b entirely behind, and the cross section of their convex hull lies inside the occluder
+b8 pvs_occludes(const PvsOccluder& o, const Vec3* a, const Vec3* b)
+{
+	r32 dist_a[8];
+	r32 dist_b[8];
+	for (s32 i = 0; i < 8; i++)
+	{
+		dist_a[i] = o.normal.dot(a[i]) - o.d;
+		if (dist_a[i] < pvs_plane_margin)
+			return false;
+		dist_b[i] = o.normal.dot(b[i]) - o.d;
+		if (dist_b[i] > -pvs_plane_margin)
+			return false;
+	}
+
+	for (s32 i = 0; i < 8; i++)
+	{
+		for (s32 j = 0; j < 8; j++)
+		{
+			Vec3 p = a[i] + (b[j] - a[i]) * (dist_a[i] / (dist_a[i] - dist_b[j]));
+			for (s32 k = 0; k < o.vertex_count; k++)
+			{
+				if ((p - o.vertices[k]).dot(o.edge_normals[k]) < pvs_edge_margin)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void pvs_cell_corners(const LevelPvs& pvs, s32 index, Vec3* corners)
+{
+	LevelPvs::Coord c = pvs.coord(index);
+	Vec3 min = pvs.vmin + Vec3(r32(c.x), r32(c.y), r32(c.z)) * pvs.chunk_size;
+	for (s32 i = 0; i < 8; i++)
+		corners[i] = min + Vec3(r32(i & 1), r32((i >> 1) & 1), r32((i >> 2) & 1)) * pvs.chunk_size;
+}
+
+void build_level_pvs(Map<Mesh>& meshes, Manifest& manifest, cJSON* json, const DroneNavMesh& drone_nav, LevelPvs* out)
+{
+	r64 timer = platform::time();
+
+	Array<PvsOccluder> occluders;
+	{
+		Mesh geometry;
+		consolidate_pvs_geometry(&geometry, meshes, manifest, json);
+		pvs_occluders(geometry, &occluders);
+	}
+
+	// cover the same volume as the drone nav mesh
+	out->resize(drone_nav.vmin, drone_nav.vmin + Vec3(r32(drone_nav.size.x), r32(drone_nav.size.y), r32(drone_nav.size.z)) * drone_nav.chunk_size, pvs_chunk_size);
+	out->occluded.length = 0;
+
+	// only cells drones can attach in are worth computing. anything else just gets raycast
+	Array<b8> occupied;
+	occupied.resize(out->chunks.length);
+	for (s32 i = 0; i < drone_nav.chunks.length; i++)
+	{
+		const DroneNavMeshChunk& chunk = drone_nav.chunks[i];
+		for (s32 j = 0; j < chunk.vertices.length; j++)
+		{
+			s32 index;
+			if (out->cell(chunk.vertices[j], &index))
+				occupied[index] = true;
+		}
+	}
+
+	s32 radius = s32(ceilf(pvs_range / pvs_chunk_size)) + 1;
+	s32 pairs = 0;
+	for (s32 i = 0; i < out->chunks.length; i++)
+	{
+		LevelPvsCell* cell = &out->chunks[i];
+		cell->start = out->occluded.length;
+		cell->count = 0;
+		if (!occupied[i])
+			continue;
+
+		Vec3 a[8];
+		pvs_cell_corners(*out, i, a);
+
+		LevelPvs::Coord ca = out->coord(i);
+		// visit neighbors in index order, so each cell's list comes out sorted
+		for (s32 y = vi_max(0, ca.y - radius); y <= vi_min(out->size.y - 1, ca.y + radius); y++)
+		{
+			for (s32 z = vi_max(0, ca.z - radius); z <= vi_min(out->size.z - 1, ca.z + radius); z++)
+			{
+				for (s32 x = vi_max(0, ca.x - radius); x <= vi_min(out->size.x - 1, ca.x + radius); x++)
+				{
+					LevelPvs::Coord cb = { x, y, z };
+					s32 j = out->index(cb);
+					if (j == i || !occupied[j])
+						continue;
+
+					Vec3 gap
+					(
+						r32(vi_max(0, abs(x - ca.x) - 1)),
+						r32(vi_max(0, abs(y - ca.y) - 1)),
+						r32(vi_max(0, abs(z - ca.z) - 1))
+					);
+					if ((gap * pvs_chunk_size).length_squared() > pvs_range * pvs_range)
+						continue;
+
+					Vec3 b[8];
+					pvs_cell_corners(*out, j, b);
+
+					Vec3 bounds_min = Vec3(vi_min(a[0].x, b[0].x), vi_min(a[0].y, b[0].y), vi_min(a[0].z, b[0].z));
+					Vec3 bounds_max = Vec3(vi_max(a[7].x, b[7].x), vi_max(a[7].y, b[7].y), vi_max(a[7].z, b[7].z));
+					for (s32 k = 0; k < occluders.length; k++)
+					{
+						const PvsOccluder& o = occluders[k];
+						if (o.bounds_max.x >= bounds_min.x && o.bounds_min.x <= bounds_max.x
+							&& o.bounds_max.y >= bounds_min.y && o.bounds_min.y <= bounds_max.y
+							&& o.bounds_max.z >= bounds_min.z && o.bounds_min.z <= bounds_max.z
+							&& pvs_occludes(o, a, b))
+						{
+							out->occluded.add(j);
+							cell->count++;
+							break;
+						}
+					}
+					pairs++;
+				}
+			}
+		}
+	}
+
+	printf("Built PVS - Occluders: %d Cell pairs: %d Occluded: %d Time: %fs\n", occluders.length, pairs, out->occluded.length, platform::time() - timer);
+}
+
 void import_level(ImporterState& state, const std::string& asset_in_path, const std::string& out_folder)
 {
 	std::string asset_name = get_asset_name(asset_in_path);
@@ -3245,6 +3597,33 @@ void import_level(ImporterState& state, const std::string& asset_in_path, const
 
 		printf("%s\n", nav_mesh_out_path.c_str());
 
+		// potentially visible set
+		{
+			LevelPvs pvs;
+			build_level_pvs(meshes, state.manifest, json, drone_nav, &pvs);
+
+			std::string pvs_out_path = out_folder + clean_asset_name + pvs_out_extension;
+			FILE* f = fopen(pvs_out_path.c_str(), "w+b");
+			if (!f)
+			{
+				fprintf(stderr, "Error: Failed to write PVS file %s.\n", pvs_out_path.c_str());
+				state.error = true;
+				return;
+			}
+
+			s32 version = LEVEL_PVS_VERSION;
+			fwrite(&version, sizeof(s32), 1, f);
+			fwrite(&pvs.chunk_size, sizeof(r32), 1, f);
+			fwrite(&pvs.vmin, sizeof(Vec3), 1, f);
+			fwrite(&pvs.size, sizeof(LevelPvs::Coord), 1, f);
+			fwrite(pvs.chunks.data, sizeof(LevelPvsCell), pvs.chunks.length, f);
+			fwrite(&pvs.occluded.length, sizeof(s32), 1, f);
+			fwrite(pvs.occluded.data, sizeof(s32), pvs.occluded.length, f);
+			fclose(f);
+
+			printf("%s\n", pvs_out_path.c_str());
+		}
+
 		nav_tiles.free();
 		Json::json_free(json);
 #endif
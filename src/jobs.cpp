@@ -0,0 +1,147 @@
+#include "jobs.h"
+#include "vi_assert.h"
+#include "lmath.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace VI
+{
+
+namespace Jobs
+{
+
+struct Job
+{
+	Function function;
+	void* data;
+	s32 count;
+	s32 grain;
+	std::atomic<s32> next;
+	std::atomic<s32> helpers; // workers still touching this job
+};
+
+struct State
+{
+	std::thread threads[JOBS_MAX_WORKERS];
+	std::mutex submit; // held for the duration of a job
+	std::mutex mutex; // protects everything below
+	std::condition_variable wake;
+	Job* job;
+	u32 generation;
+	s32 worker_count;
+	b8 quit;
+};
+State state;
+thread_local b8 working; // true while this thread is inside a job. nested jobs just run inline
+
+void job_run(Job* job)
+{
+	working = true;
+	while (true)
+	{
+		s32 start = job->next.fetch_add(job->grain);
+		if (start >= job->count)
+			break;
+		job->function(start, vi_min(start + job->grain, job->count), job->data);
+	}
+	working = false;
+}
+
+void worker()
+{
+	u32 generation = 0;
+	while (true)
+	{
+		Job* job;
+		{
+			std::unique_lock<std::mutex> lock(state.mutex);
+			state.wake.wait(lock, [&generation] { return state.quit || (state.job && state.generation != generation); });
+			if (state.quit)
+				return;
+			generation = state.generation;
+			job = state.job;
+			job->helpers++;
+		}
+		job_run(job);
+		job->helpers--; // the job may go away as soon as this hits zero
+	}
+}
+
+void init(s32 count)
+{
+	vi_assert(state.worker_count == 0);
+	if (count < 0)
+		count = s32(std::thread::hardware_concurrency()) - 1;
+	count = vi_max(0, vi_min(JOBS_MAX_WORKERS, count));
+
+	state.quit = false;
+	state.worker_count = count;
+	for (s32 i = 0; i < count; i++)
+		state.threads[i] = std::thread(worker);
+}
+
+void term()
+{
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.quit = true;
+	}
+	state.wake.notify_all();
+	for (s32 i = 0; i < state.worker_count; i++)
+		state.threads[i].join();
+	state.worker_count = 0;
+}
+
+s32 workers()
+{
+	return state.worker_count;
+}
+
+void parallel_for(s32 count, s32 grain, Function function, void* data)
+{
+	if (count <= 0)
+		return;
+
+	grain = vi_max(1, grain);
+
+	std::unique_lock<std::mutex> submit;
+	if (!working && state.worker_count > 0 && count > grain)
+		submit = std::unique_lock<std::mutex>(state.submit, std::try_to_lock);
+	if (!submit.owns_lock())
+	{
+		// nested, not worth splitting, or another thread is already using the pool
+		function(0, count, data);
+		return;
+	}
+
+	Job job;
+	job.function = function;
+	job.data = data;
+	job.count = count;
+	job.grain = grain;
+	job.next = 0;
+	job.helpers = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.job = &job;
+		state.generation++;
+	}
+	state.wake.notify_all();
+
+	job_run(&job);
+
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+		state.job = nullptr; // no new helpers from here on
+	}
+
+	while (job.helpers.load() > 0) // the stragglers are each finishing their last chunk
+		std::this_thread::yield();
+}
+
+}
+
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "types.h"
+
+namespace VI
+{
+
+// small pool of worker threads for splitting data-parallel work (batched raycasts, etc.) across cores.
+// only one job runs at a time; if the pool is busy, the caller just does the work itself
+namespace Jobs
+{
+
+#define JOBS_MAX_WORKERS 15
+
+typedef void (*Function)(s32, s32, void*); // start index, end index, user data
+
+void init(s32 = -1); // number of worker threads. -1 = one fewer than the number of hardware threads
+void term();
+s32 workers();
+void parallel_for(s32, s32, Function, void*); // count, grain size. returns once every item is done
+
+}
+
+}
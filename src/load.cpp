@@ -12,6 +12,9 @@
 #include "ai.h"
 #include "settings.h"
 #include "game/master.h"
+#include "platform/util.h"
+#include <thread>
+#include <bullet/src/BulletCollision/CollisionShapes/btOptimizedBvh.h>
 
 namespace VI
 {
@@ -56,6 +59,7 @@ namespace Settings
 	b8 god_mode;
 	b8 quick_combat_unlocked;
 	b8 parkour_reticle;
+	b8 physics_multithreaded;
 	NetClientInterpolationMode net_client_interpolation_mode;
 	PvpColorScheme pvp_color_scheme;
 
@@ -102,6 +106,11 @@ void Loader::init(LoopSwapper* s)
 {
 	swapper = s;
 
+#if SERVER
+	if (compiled_static_mesh_count > 0) // already counted by Loader::preload
+		return;
+#endif
+
 	// count levels, static meshes, and static textures at runtime to avoid recompiling all the time
 	const char* p;
 	while ((p = AssetLookup::Level::names[compiled_level_count]))
@@ -184,6 +193,24 @@ void Loader::init(LoopSwapper* s)
 #endif
 }
 
+#if SERVER
+// loads everything the server needs that never changes at runtime, before any threads start.
+// a zygote server does this once and shares it copy-on-write with every match it forks.
+void Loader::preload()
+{
+	init(nullptr);
+
+	for (AssetID i = 0; i < static_mesh_count; i++)
+		mesh_permanent(i);
+
+	for (AssetID i = 0; i < armature_count; i++)
+		armature_permanent(i);
+
+	for (AssetID i = 0; i < animation_count; i++)
+		animation_permanent(i);
+}
+#endif
+
 InputBinding input_binding(cJSON* parent, const char* key, const InputBinding& default_value)
 {
 	if (!parent)
@@ -297,6 +324,7 @@ void Loader::settings_load(const Array<DisplayMode>& modes, const DisplayMode& c
 	Settings::god_mode = b8(Json::get_s32(json, "god_mode"));
 	Settings::quick_combat_unlocked = b8(Json::get_s32(json, "quick_combat_unlocked"));
 	Settings::parkour_reticle = b8(Json::get_s32(json, "parkour_reticle"));
+	Settings::physics_multithreaded = b8(Json::get_s32(json, "physics_multithreaded"));
 #if SERVER
 	Settings::shell_casings = false;
 #else
@@ -358,6 +386,8 @@ void Loader::settings_save()
 		cJSON_AddNumberToObject(json, "record", 1);
 	if (Settings::expo)
 		cJSON_AddNumberToObject(json, "expo", 1);
+	if (Settings::physics_multithreaded)
+		cJSON_AddNumberToObject(json, "physics_multithreaded", 1);
 
 	// only save master server setting if it is not the default
 	if (strncmp(Settings::master_server, default_master_server, MAX_PATH_LENGTH) != 0)
@@ -523,10 +553,84 @@ const Mesh* Loader::mesh_instanced(AssetID id)
 	return m;
 }
 
+// deserialized in place, so the buffer has to live as long as the BVH
+struct MeshBvh
+{
+	void* buffer;
+	btOptimizedBvh* bvh;
+	b8 loaded;
+};
+Array<MeshBvh> mesh_bvhs;
+
+btOptimizedBvh* Loader::mesh_bvh(AssetID id)
+{
+	const Mesh* mesh = Loader::mesh(id);
+	if (!mesh)
+		return nullptr;
+
+	if (id >= mesh_bvhs.length)
+		mesh_bvhs.resize(id + 1);
+	MeshBvh* entry = &mesh_bvhs[id];
+	if (!entry->loaded)
+	{
+		entry->loaded = true;
+
+		// same path as the mesh, with a .bvh extension
+		char path[MAX_PATH_LENGTH + 1];
+		strncpy(path, mesh_path(id), MAX_PATH_LENGTH);
+		path[MAX_PATH_LENGTH] = '\0';
+		char* extension = strrchr(path, '.');
+		if (extension && strlen(extension) == 4)
+		{
+			strcpy(extension, ".bvh");
+
+			FILE* f = fopen(path, "rb");
+			if (f)
+			{
+				MeshBvhHeader header;
+				if (fread(&header, sizeof(MeshBvhHeader), 1, f) == 1
+					&& header.version == MESH_BVH_VERSION
+					&& header.scalar_size == s32(sizeof(btScalar))
+					&& header.vertex_count == mesh->vertices.length
+					&& header.index_count == mesh->indices.length)
+				{
+					entry->buffer = btAlignedAlloc(header.size, 16);
+					if (fread(entry->buffer, 1, header.size, f) == header.size)
+						entry->bvh = btOptimizedBvh::deSerializeInPlace(entry->buffer, header.size, false);
+					if (!entry->bvh)
+					{
+						btAlignedFree(entry->buffer);
+						entry->buffer = nullptr;
+					}
+				}
+				fclose(f);
+
+				if (!entry->bvh)
+					vi_debug("Ignoring stale BVH %s", path);
+			}
+		}
+	}
+	return entry->bvh;
+}
+
+void mesh_bvh_free(AssetID id)
+{
+	if (id < mesh_bvhs.length)
+	{
+		MeshBvh* entry = &mesh_bvhs[id];
+		if (entry->bvh)
+			entry->bvh->~btOptimizedBvh(); // doesn't own any memory; everything points into the buffer
+		if (entry->buffer)
+			btAlignedFree(entry->buffer);
+		new (entry) MeshBvh();
+	}
+}
+
 void Loader::mesh_free(AssetID id)
 {
 	if (id != AssetNull && meshes[id].type != AssetNone)
 	{
+		mesh_bvh_free(id);
 		meshes[id].data.~Mesh();
 #if !SERVER
 		RenderSync* sync = swapper->get();
@@ -1076,13 +1180,145 @@ const char* nav_mesh_path(AssetID id)
 		return mod_nav_paths[id - Loader::compiled_level_count];
 }
 
+// the next level's JSON is parsed on a background thread while the current match winds down,
+// and the files load_level will read are pulled into the OS page cache along the way
+struct LevelPrefetch
+{
+	std::thread thread;
+	cJSON* json;
+	r64 duration;
+	AssetID id = AssetNull;
+
+	~LevelPrefetch()
+	{
+		if (thread.joinable())
+			thread.join();
+	}
+};
+LevelPrefetch level_prefetch_state;
+
+#if SERVER
+// the server hangs on to the parsed JSON of the last level it loaded,
+// so restarting a match on the same level skips the parse entirely
+struct LevelCache
+{
+	cJSON* json;
+	AssetID id = AssetNull;
+};
+LevelCache level_cache;
+#endif
+
+void file_warm(const char* path)
+{
+	FILE* f = fopen(path, "rb");
+	if (f)
+	{
+		char buffer[64 * 1024];
+		while (fread(buffer, 1, sizeof(buffer), f) == sizeof(buffer))
+		{
+		}
+		fclose(f);
+	}
+}
+
+void level_prefetch_thread(AssetID id, GameType game_type)
+{
+	r64 start = platform::time();
+
+	cJSON* json = Json::load(Loader::level_path(id));
+	if (json)
+	{
+		for (cJSON* element = json->child; element; element = element->next)
+		{
+			cJSON* meshes = cJSON_GetObjectItem(element, "meshes");
+			for (cJSON* mesh = meshes ? meshes->child : nullptr; mesh; mesh = mesh->next)
+			{
+				AssetID mesh_id = Loader::find_mesh(mesh->valuestring);
+				if (mesh_id != AssetNull)
+					file_warm(Loader::mesh_path(mesh_id));
+			}
+		}
+	}
+
+	file_warm(nav_mesh_path(id));
+	char record_path[MAX_PATH_LENGTH + 1];
+	Loader::ai_record_path(record_path, id, game_type);
+	file_warm(record_path);
+
+	level_prefetch_state.json = json;
+	level_prefetch_state.duration = platform::time() - start;
+}
+
+// wait for any prefetch in progress and take its result
+cJSON* level_prefetch_join(AssetID* id)
+{
+	*id = level_prefetch_state.id;
+	if (level_prefetch_state.thread.joinable())
+		level_prefetch_state.thread.join();
+	cJSON* json = level_prefetch_state.json;
+	level_prefetch_state.json = nullptr;
+	level_prefetch_state.id = AssetNull;
+	return json;
+}
+
+void Loader::level_prefetch(AssetID id, GameType game_type)
+{
+	if (id == AssetNull || id == level_prefetch_state.id)
+		return;
+#if SERVER
+	if (id == level_cache.id)
+		return;
+#endif
+
+	{
+		AssetID old_id;
+		cJSON* old = level_prefetch_join(&old_id);
+		if (old)
+			level_free(old);
+	}
+
+	vi_debug("Prefetching level %d", s32(id));
+	level_prefetch_state.id = id;
+	level_prefetch_state.thread = std::thread(level_prefetch_thread, id, game_type);
+}
+
 cJSON* Loader::level(AssetID id)
 {
-	return Json::load(level_path(id));
+#if SERVER
+	if (id != AssetNull && id == level_cache.id)
+		return level_cache.json;
+#endif
+
+	cJSON* json = nullptr;
+	if (id != AssetNull && id == level_prefetch_state.id)
+	{
+		AssetID prefetched_id;
+		json = level_prefetch_join(&prefetched_id);
+		if (json)
+			vi_debug("Level %d was parsed in the background in %.1fms", s32(id), level_prefetch_state.duration * 1000.0);
+	}
+	if (!json)
+		json = Json::load(level_path(id));
+
+#if SERVER
+	if (json)
+	{
+		if (level_cache.json)
+			Json::json_free(level_cache.json);
+		level_cache.json = json;
+		level_cache.id = id;
+	}
+#endif
+
+	return json;
 }
 
 void Loader::level_free(cJSON* json)
 {
+#if SERVER
+	if (json == level_cache.json)
+		return; // stays cached until a different level replaces it
+#endif
 	Json::json_free((cJSON*)json);
 }
 
@@ -1103,6 +1339,49 @@ void Loader::nav_mesh_free()
 	AI::load(AssetNull, nullptr, nullptr);
 }
 
+struct LevelPvsCache
+{
+	LevelPvs pvs;
+	AssetID id = AssetNull;
+	b8 valid;
+};
+LevelPvsCache level_pvs_cache;
+
+const LevelPvs* Loader::level_pvs(AssetID id)
+{
+	if (id == AssetNull)
+		return nullptr;
+
+	if (id != level_pvs_cache.id)
+	{
+		level_pvs_cache.id = id;
+		level_pvs_cache.valid = false;
+		level_pvs_cache.pvs.size = {};
+		level_pvs_cache.pvs.resize();
+		level_pvs_cache.pvs.occluded.length = 0;
+
+		// same path as the nav mesh, with a .pvs extension
+		char path[MAX_PATH_LENGTH + 1];
+		strncpy(path, nav_mesh_path(id), MAX_PATH_LENGTH);
+		path[MAX_PATH_LENGTH] = '\0';
+		char* extension = strrchr(path, '.');
+		if (extension && strlen(extension) == 4)
+		{
+			strcpy(extension, ".pvs");
+			FILE* f = fopen(path, "rb");
+			if (f)
+			{
+				level_pvs_cache.valid = level_pvs_cache.pvs.read(f);
+				fclose(f);
+				if (!level_pvs_cache.valid)
+					vi_debug("Ignoring stale PVS %s", path);
+			}
+		}
+	}
+
+	return level_pvs_cache.valid ? &level_pvs_cache.pvs : nullptr;
+}
+
 b8 Loader::soundbank(AssetID id)
 {
 #if SERVER
@@ -1153,14 +1432,17 @@ void Loader::soundbank_free(AssetID id)
 #endif
 }
 
-void Loader::transients_free()
+void Loader::transients_free(b8 keep_meshes)
 {
 	nav_mesh_free();
 
-	for (AssetID i = 0; i < meshes.length; i++)
+	if (!keep_meshes)
 	{
-		if (meshes[i].type == AssetTransient)
-			mesh_free(i);
+		for (AssetID i = 0; i < meshes.length; i++)
+		{
+			if (meshes[i].type == AssetTransient)
+				mesh_free(i);
+		}
 	}
 
 	for (AssetID i = 0; i < textures.length; i++)
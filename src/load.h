@@ -9,6 +9,7 @@
 #include "settings.h"
 
 struct cJSON;
+class btOptimizedBvh;
 
 namespace VI
 {
@@ -38,6 +39,9 @@ struct Loader
 	static s32 animation_count;
 	static LoopSwapper* swapper;
 	static void init(LoopSwapper*);
+#if SERVER
+	static void preload();
+#endif
 	static Array<Entry<Mesh> > meshes;
 	static Array<Entry<Animation> > animations;
 	static Array<Entry<Armature> > armatures;
@@ -57,6 +61,7 @@ struct Loader
 	static const Mesh* mesh(AssetID);
 	static const Mesh* mesh_permanent(AssetID);
 	static const Mesh* mesh_instanced(AssetID);
+	static btOptimizedBvh* mesh_bvh(AssetID); // precomputed collision BVH, or null if there isn't a valid one
 	static void mesh_free(AssetID);
 
 	static s32 dynamic_mesh(s32, b8 dynamic = true);
@@ -94,11 +99,13 @@ struct Loader
 	static const Font* font_permanent(AssetID);
 	static void font_free(AssetID);
 
-	static cJSON* level(AssetID);
+	static void level_prefetch(AssetID, GameType); // start parsing the given level on a background thread
+	static cJSON* level(AssetID); // takes the cached or prefetched level if it matches; otherwise loads synchronously
 	static void level_free(cJSON*);
 
 	static void nav_mesh(AssetID, GameType);
 	static void nav_mesh_free();
+	static const LevelPvs* level_pvs(AssetID); // null if the level doesn't have a valid one
 
 	static b8 soundbank(AssetID);
 	static b8 soundbank_permanent(AssetID);
@@ -107,7 +114,7 @@ struct Loader
 	static void settings_load(const Array<DisplayMode>&, const DisplayMode&);
 	static void settings_save();
 
-	static void transients_free();
+	static void transients_free(b8 = false); // true to keep meshes resident when the same level is about to be reloaded
 
 	static AssetID find(const char*, const char**, s32 = -1);
 	static AssetID find_level(const char*);
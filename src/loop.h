@@ -19,6 +19,12 @@
 #include "game/team.h"
 #include "game/entities.h"
 #include "net.h"
+#include "tick.h"
+#if SERVER
+#include "metrics.h"
+#include "benchmark.h"
+#include "shed.h"
+#endif
 
 #if DEBUG
 	#define DEBUG_RENDER 0
@@ -1625,12 +1631,23 @@ void loop(LoopSwapper* swapper_render, PhysicsSwapper* swapper_physics)
 	mersenne::srand(u32(platform::timestamp()));
 	noise::reseed();
 
+#if SERVER
+	// headless: nothing consumes the render queue, so there's one LoopSync that is never swapped.
+	// it only exists because Loader and friends write render commands unconditionally; it gets cleared every tick.
+	LoopSync* sync_render = swapper_render->get();
+#else
 	LoopSync* sync_render = swapper_render->swap<SwapType::Write>();
+#endif
 
 	Loader::init(swapper_render);
 
 	Game::init(sync_render);
 
+#if SERVER
+	if (Benchmark::active())
+		Benchmark::start();
+#endif
+
 	g_albedo_buffer = Loader::dynamic_texture_permanent();
 	g_normal_buffer = Loader::dynamic_texture_permanent();
 	g_depth_buffer = Loader::dynamic_texture_permanent();
@@ -1699,12 +1716,13 @@ void loop(LoopSwapper* swapper_render, PhysicsSwapper* swapper_physics)
 
 	PhysicsSync* sync_physics = nullptr;
 
-	r32 time_update = 0.0f; // time required for update
-
 	while (!Game::quit)
 	{
 		// update loop
 
+#if SERVER
+		sync_render->quit |= platform::quit;
+#endif
 		Game::quit |= sync_render->quit;
 
 		{
@@ -1712,18 +1730,14 @@ void loop(LoopSwapper* swapper_render, PhysicsSwapper* swapper_physics)
 
 			r32 dt_limit;
 #if SERVER
-			dt_limit = Net::tick_rate();
+			dt_limit = Benchmark::active() ? 0.0f : Net::tick_rate();
 #else
 			dt_limit = vi_max(1.0f / r32(Settings::framerate_limit), sync_render->input.focus ? 0.0f : (1.0f / 30.0f));
 #endif
 
-			r32 delay = dt_limit - time_update;
-			if (delay > 0)
-				platform::sleep(delay);
+			Tick::wait(dt_limit);
 		}
 
-		r64 time_update_start = platform::time();
-
 #if DEBUG
 		if (sync_render->input.keys.get(s32(KeyCode::F5)))
 			vi_assert(false);
@@ -1770,9 +1784,18 @@ void loop(LoopSwapper* swapper_render, PhysicsSwapper* swapper_physics)
 
 		memcpy(&last_input, &sync_render->input, sizeof(last_input));
 
-		time_update = r32(platform::time() - time_update_start);
+		Tick::done();
+
+#if SERVER
+		if (!Benchmark::active()) // benchmarks always run everything at full fidelity
+			Shed::update(Net::tick_rate());
+		Metrics::update();
+		Benchmark::tick();
+#endif
 
+#if !SERVER
 		sync_render = swapper_render->swap<SwapType::Write>();
+#endif
 		sync_render->queue.length = 0;
 	}
 
@@ -1782,6 +1805,11 @@ void loop(LoopSwapper* swapper_render, PhysicsSwapper* swapper_physics)
 		swapper_physics->done<SwapType::Write>();
 	}
 
+#if SERVER
+	Tick::dump("ticks.json");
+	Benchmark::report("benchmark.json");
+#endif
+
 	Game::term();
 }
 
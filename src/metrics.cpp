@@ -0,0 +1,199 @@
+#include "metrics.h"
+#include "vi_assert.h"
+#include "mongoose/mongoose.h"
+#include "tick.h"
+#include "net.h"
+#include "ai.h"
+#include "physics.h"
+#include "shed.h"
+#include "data/entity.h"
+#include <stdio.h>
+#include <stdarg.h>
+#if !_WIN32
+#include <unistd.h>
+#endif
+
+namespace VI
+{
+
+namespace Metrics
+{
+
+mg_mgr mgr;
+mg_connection* conn;
+
+void Writer::printf(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	s32 needed = vsnprintf(nullptr, 0, format, args);
+	va_end(args);
+	if (needed <= 0)
+		return;
+
+	s32 start = buffer.length;
+	buffer.resize(start + needed + 1); // room for vsnprintf's null terminator
+	va_start(args, format);
+	vsnprintf(&buffer[start], needed + 1, format, args);
+	va_end(args);
+	buffer.length = start + needed;
+}
+
+void Writer::header(const char* name, const char* type, const char* help)
+{
+	printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+void Writer::value(const char* name, r64 value, const char* labels)
+{
+	if (labels)
+		printf("%s{%s} %.9g\n", name, labels, value);
+	else
+		printf("%s %.9g\n", name, value);
+}
+
+void histogram_summary(Writer* w, const char* name, const char* help, const Tick::Histogram& h)
+{
+	w->header(name, "summary", help);
+	const r32 quantiles[] = { 0.5f, 0.9f, 0.99f };
+	for (s32 i = 0; i < s32(sizeof(quantiles) / sizeof(quantiles[0])); i++)
+	{
+		char labels[32];
+		snprintf(labels, sizeof(labels), "quantile=\"%g\"", quantiles[i]);
+		w->value(name, r64(h.percentile(quantiles[i])) / 1000000.0, labels);
+	}
+	w->printf("%s_sum %.9g\n", name, r64(h.total_us) / 1000000.0);
+	w->printf("%s_count %llu\n", name, (unsigned long long)h.count);
+}
+
+// resident set size in bytes, or 0 if we can't tell
+u64 memory_resident()
+{
+#if _WIN32
+	return 0;
+#else
+	u64 result = 0;
+	FILE* f = fopen("/proc/self/statm", "r");
+	if (f)
+	{
+		unsigned long long size;
+		unsigned long long resident;
+		if (fscanf(f, "%llu %llu", &size, &resident) == 2)
+			result = u64(resident) * u64(sysconf(_SC_PAGESIZE));
+		fclose(f);
+	}
+	return result;
+#endif
+}
+
+void write(Writer* w)
+{
+	histogram_summary(w, "deceiver_tick_duration_seconds", "Time spent doing the work of each update tick.", Tick::duration());
+	histogram_summary(w, "deceiver_tick_lateness_seconds", "How long after its deadline each update tick started.", Tick::lateness());
+	w->header("deceiver_ticks_skipped_total", "counter", "Ticks dropped because the server fell too far behind.");
+	w->value("deceiver_ticks_skipped_total", r64(Tick::skipped()));
+
+	Shed::metrics(w);
+
+	const PhysicsStats& physics = Physics::stats;
+	histogram_summary(w, "deceiver_physics_step_seconds", "Time the physics thread spent in each Bullet step.", physics.step);
+	histogram_summary(w, "deceiver_physics_sync_static_seconds", "Time spent copying transforms of static and kinematic bodies into Bullet.", physics.sync_static);
+	histogram_summary(w, "deceiver_physics_sync_dynamic_seconds", "Time spent copying transforms of dynamic bodies out of Bullet.", physics.sync_dynamic);
+	w->header("deceiver_physics_substeps_total", "counter", "Fixed-timestep substeps Bullet has simulated.");
+	w->value("deceiver_physics_substeps_total", r64(physics.substeps));
+	w->header("deceiver_physics_bodies_active", "gauge", "Dynamic bodies awake after the most recent step.");
+	w->value("deceiver_physics_bodies_active", r64(physics.last.bodies_active));
+	w->header("deceiver_physics_manifolds", "gauge", "Contact manifolds after the most recent step.");
+	w->value("deceiver_physics_manifolds", r64(physics.last.manifolds));
+	w->header("deceiver_physics_contacts", "gauge", "Contact points after the most recent step.");
+	w->value("deceiver_physics_contacts", r64(physics.last.contacts));
+
+	w->header("deceiver_ai_queue_depth", "gauge", "AI requests waiting on the worker thread.");
+	w->value("deceiver_ai_queue_depth", r64(AI::callback_in_id - AI::callback_out_id));
+
+	w->header("deceiver_entities", "gauge", "Live entities.");
+	w->value("deceiver_entities", r64(Entity::list.count()));
+
+	w->header("deceiver_components", "gauge", "Live components by type.");
+	for (s32 i = 0; i < World::families; i++)
+	{
+		char labels[64];
+		snprintf(labels, sizeof(labels), "type=\"%s\"", World::component_names[i]);
+		w->value("deceiver_components", r64(World::component_pools[i]->count()), labels);
+	}
+
+	Net::metrics(w);
+
+	w->header("deceiver_memory_resident_bytes", "gauge", "Resident set size of the process.");
+	w->value("deceiver_memory_resident_bytes", r64(memory_resident()));
+}
+
+void handle(mg_connection* c, int ev, void* ev_data)
+{
+	if (ev != MG_EV_HTTP_REQUEST)
+		return;
+
+	Writer w;
+	write(&w);
+
+	mg_printf
+	(
+		c,
+		"HTTP/1.1 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: %d\r\n"
+		"Connection: close\r\n"
+		"\r\n",
+		w.buffer.length
+	);
+	mg_send(c, w.buffer.data, w.buffer.length);
+	c->flags |= MG_F_SEND_AND_CLOSE;
+}
+
+void ev_handler(mg_connection* c, int ev, void* ev_data)
+{
+	if (ev == MG_EV_HTTP_REQUEST)
+	{
+		mg_printf
+		(
+			c, "%s",
+			"HTTP/1.1 404 Not Found\r\n"
+			"Content-Length: 0\r\n"
+			"Connection: close\r\n"
+			"\r\n"
+		);
+		c->flags |= MG_F_SEND_AND_CLOSE;
+	}
+}
+
+void init(u16 port)
+{
+	mg_mgr_init(&mgr, nullptr);
+	char addr[32];
+	sprintf(addr, "127.0.0.1:%d", s32(port));
+	conn = mg_bind(&mgr, addr, ev_handler);
+	if (conn)
+	{
+		mg_set_protocol_http_websocket(conn);
+		mg_register_http_endpoint(conn, "/metrics", handle);
+		vi_debug("Metrics bound to %s", addr);
+	}
+	else
+		vi_debug("Failed to bind metrics to %s", addr);
+}
+
+void update()
+{
+	if (conn)
+		mg_mgr_poll(&mgr, 0);
+}
+
+void term()
+{
+	mg_mgr_free(&mgr);
+	conn = nullptr;
+}
+
+}
+
+}
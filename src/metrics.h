@@ -0,0 +1,29 @@
+#pragma once
+#include "types.h"
+#include "data/array.h"
+
+namespace VI
+{
+
+// local HTTP endpoint for scraping game server metrics in the Prometheus text format.
+// bound to loopback on the same port number as the game's UDP socket, so every server on a box gets its own.
+// served from the update thread, so everything can be read without locking.
+namespace Metrics
+{
+
+struct Writer
+{
+	Array<char> buffer;
+
+	void printf(const char*, ...);
+	void header(const char*, const char*, const char*); // name, type, help
+	void value(const char*, r64, const char* = nullptr); // name, value, labels
+};
+
+void init(u16);
+void update();
+void term();
+
+}
+
+}
@@ -1,9 +1,13 @@
 #define WIN32_LEAN_AND_MEAN
 #include "net.h"
+#include "net_schema.h"
 #include "platform/sock.h"
 #include "game/game.h"
 #if SERVER
 #include "asset/level.h"
+#include "metrics.h"
+#include "benchmark.h"
+#include "shed.h"
 #endif
 #include "mersenne/mersenne-twister.h"
 #include "common.h"
@@ -32,8 +36,11 @@
 #include "settings.h"
 #include "cjson/cJSON.h"
 #include <array>
+#include <random>
 #include "data/import_common.h"
 #include "data/unicode.h"
+#include "data/json.h"
+#include <chrono>
 
 #define DEBUG_MSG 0
 #define DEBUG_ENTITY 0
@@ -45,6 +52,14 @@
 
 #define MASTER_AUTH_TIMEOUT 8.0f
 #define NET_EXPECTED_CLIENT_TIMEOUT 30.0f
+#define INTERPOLATION_DELAY_MIN 1.5f // in ticks
+#define INTERPOLATION_DELAY_MAX 5.0f // in ticks
+#define INTERPOLATION_SLEW 0.1f // interpolated timeline may run at most 10% faster or slower than real time while the delay adapts
+#define INTERPOLATION_SLEW_UNDERRUN 0.25f // slow down faster if we run out of state frames
+#define INTERPOLATION_SYNC_INTERVAL 0.5f // minimum time between interpolation delay updates sent to the server
+#define STATS_INTERVAL 5.0f
+#define NET_DISTANT_RANGE (DRONE_MAX_DISTANCE * 2.0f) // when shedding load, transforms farther than this from every player are sent at low resolution
+#define STATS_LOG_INTERVAL 60.0f // server only; clients log every interval while show_stats is on
 
 namespace VI
 {
@@ -126,6 +141,105 @@ struct MessageFrameState
 typedef StaticArray<SequenceHistoryEntry, NET_SEQUENCE_RESEND_BUFFER> SequenceHistory;
 typedef Array<StreamWrite> MessageBuffer;
 
+// telemetry
+
+enum class StateFrameSection : s8
+{
+	Transforms,
+	Players,
+	Walkers,
+	Drones,
+	Parkours,
+	count,
+};
+
+// entities spawned often enough during play that EntityCreate sends them as a delta from known defaults
+enum class Prefab : s8
+{
+	None,
+	Bolt,
+	Grenade,
+	Minion,
+	Battery,
+	Turret,
+	count,
+};
+
+const char* message_type_names[s32(MessageType::count)] =
+{
+	"Noop",
+	"EntityCreate",
+	"EntityRemove",
+	"Drone",
+	"PlayerControlHuman",
+	"Health",
+	"Battery",
+	"PlayerManager",
+	"ParticleEffect",
+	"Team",
+	"ClientSetup",
+	"Bolt",
+	"Grenade",
+	"UpgradeStation",
+	"InitDone",
+	"LoadingDone",
+	"TimeSync",
+	"Parkour",
+	"Turret",
+	"Glass",
+	"Flag",
+	"TransitionLevel",
+	"AddPlayer",
+	"DebugCommand",
+	"InterpolationDelay",
+};
+
+const char* state_frame_section_names[s32(StateFrameSection::count)] =
+{
+	"transforms",
+	"players",
+	"walkers",
+	"drones",
+	"parkours",
+};
+
+const char* prefab_names[s32(Prefab::count)] =
+{
+	"none",
+	"bolt",
+	"grenade",
+	"minion",
+	"battery",
+	"turret",
+};
+
+struct StatsEntry
+{
+	u64 bits;
+	u64 ns; // time spent encoding, or decoding and applying
+	u32 count;
+};
+
+// must contain only StatsEntry members; see stats_merge
+struct Stats
+{
+	StatsEntry msgs_out[s32(MessageType::count)];
+	StatsEntry msgs_in[s32(MessageType::count)];
+	StatsEntry state_frame_out[s32(StateFrameSection::count)];
+	StatsEntry state_frame_in[s32(StateFrameSection::count)];
+	StatsEntry entity_create_out[s32(Prefab::count)];
+	StatsEntry entity_create_in[s32(Prefab::count)];
+	StatsEntry packets_out;
+	StatsEntry packets_in;
+};
+
+// message currently being built between msg_new and msg_finalize
+struct MessageEncode
+{
+	const StreamWrite* msg;
+	u64 start;
+};
+
 // server/client data
 struct StateCommon
 {
@@ -138,26 +252,157 @@ struct StateCommon
 	s32 bandwidth_in_counter;
 	s32 bandwidth_out_counter;
 	r32 timestamp;
+	r32 stats_timer;
+	r32 stats_log_timer;
+	Stats stats; // since the level was loaded
+	Stats stats_window; // current interval
+	Stats stats_last; // most recent complete interval
+	Stats stats_log; // accumulated since the last log line
+	StaticArray<MessageEncode, 8> msgs_encoding;
 };
 StateCommon state_common;
 
+u64 stats_clock()
+{
+	return u64(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void stats_add(StatsEntry* entry, s32 bits, u64 ns)
+{
+	entry->bits += bits;
+	entry->ns += ns;
+	entry->count++;
+}
+
+void stats_merge(StatsEntry* dest, const StatsEntry* src, s32 count)
+{
+	for (s32 i = 0; i < count; i++)
+	{
+		dest[i].bits += src[i].bits;
+		dest[i].ns += src[i].ns;
+		dest[i].count += src[i].count;
+	}
+}
+
+void stats_merge(Stats* dest, const Stats& src)
+{
+	stats_merge((StatsEntry*)dest, (const StatsEntry*)&src, s32(sizeof(Stats) / sizeof(StatsEntry)));
+}
+
+s32 stream_bits(const StreamWrite* p)
+{
+	return p->bits_written();
+}
+
+s32 stream_bits(const StreamRead* p)
+{
+	return p->bits_read;
+}
+
+// records the state frame section that just finished and starts timing the next one
+template<typename Stream> void stats_state_frame_section(Stream* p, StatsEntry* sections, StateFrameSection section, s32* bits, u64* time)
+{
+	if (sections)
+	{
+		u64 t = stats_clock();
+		s32 b = stream_bits(p);
+		stats_add(&sections[s32(section)], b - *bits, t - *time);
+		*bits = b;
+		*time = t;
+	}
+}
+
+// peeks at the type of the next message without consuming it
+b8 msg_peek_type(StreamRead* p, MessageType* result)
+{
+	using Stream = StreamRead;
+	s32 start = p->bits_read;
+	serialize_enum(p, MessageType, *result);
+	p->rewind(start);
+	return true;
+}
+
+void stats_msg_in(MessageType type, s32 bits, u64 ns, Stats* client = nullptr)
+{
+	stats_add(&state_common.stats_window.msgs_in[s32(type)], bits, ns);
+	if (client)
+		stats_add(&client->msgs_in[s32(type)], bits, ns);
+}
+
+// writes the largest few entries as "name rate time-per-item" pairs
+void stats_format_top(char* buffer, s32 buffer_size, const StatsEntry* entries, const char** names, s32 count, r32 interval, s32 top)
+{
+	buffer[0] = '\0';
+	u32 printed = 0; // bitmask; count is always <= 32
+	s32 length = 0;
+	for (s32 i = 0; i < top; i++)
+	{
+		s32 best = -1;
+		for (s32 j = 0; j < count; j++)
+		{
+			if (!(printed & (1 << j)) && entries[j].bits > 0 && (best == -1 || entries[j].bits > entries[best].bits))
+				best = j;
+		}
+		if (best == -1)
+			break;
+		printed |= 1 << best;
+		const StatsEntry& e = entries[best];
+		length += snprintf(&buffer[length], buffer_size - length, "%s%s %.1fkbps %.0fus", i > 0 ? " | " : "", names[best], r32(e.bits) / (interval * 1000.0f), r32(e.ns) / (r32(e.count) * 1000.0f));
+		if (length >= buffer_size)
+			break;
+	}
+}
+
+void stats_log(const Stats& stats, r32 interval)
+{
+	char msgs_out[512];
+	char msgs_in[512];
+	char frames_out[512];
+	char frames_in[512];
+	char creates_out[512];
+	char creates_in[512];
+	stats_format_top(msgs_out, sizeof(msgs_out), stats.msgs_out, message_type_names, s32(MessageType::count), interval, 4);
+	stats_format_top(msgs_in, sizeof(msgs_in), stats.msgs_in, message_type_names, s32(MessageType::count), interval, 4);
+	stats_format_top(frames_out, sizeof(frames_out), stats.state_frame_out, state_frame_section_names, s32(StateFrameSection::count), interval, s32(StateFrameSection::count));
+	stats_format_top(frames_in, sizeof(frames_in), stats.state_frame_in, state_frame_section_names, s32(StateFrameSection::count), interval, s32(StateFrameSection::count));
+	stats_format_top(creates_out, sizeof(creates_out), stats.entity_create_out, prefab_names, s32(Prefab::count), interval, s32(Prefab::count));
+	stats_format_top(creates_in, sizeof(creates_in), stats.entity_create_in, prefab_names, s32(Prefab::count), interval, s32(Prefab::count));
+	vi_debug("Net stats over %.0fs: %.1fkbps out, %.1fkbps in. Messages out: %s. Messages in: %s. State frames out: %s. State frames in: %s. Entities created out: %s. Entities created in: %s.",
+		interval,
+		r32(stats.packets_out.bits) / (interval * 1000.0f),
+		r32(stats.packets_in.bits) / (interval * 1000.0f),
+		msgs_out, msgs_in, frames_out, frames_in, creates_out, creates_in);
+}
+
+struct PacketEntry
+{
+	r32 timestamp;
+	StreamRead packet;
+	Sock::Address address;
+	PacketEntry() : timestamp(), packet(), address() {}
+};
+
 struct StatePersistent
 {
 	Sock::Handle sock;
 	Master::Messenger master;
 	Sock::Address master_addr;
+	Array<PacketEntry*> packet_pool;
+	StreamRead packet_decoded; // every received packet is decompressed into this buffer and parsed from here
 };
 StatePersistent state_persistent;
 
-r32 internal_interpolation_delay(b8 low_latency)
+r32 interpolation_delay_clamp(r32 delay)
 {
-	return tick_rate() * (low_latency ? 1.5f : 5.0f);
+	r32 tick = tick_rate();
+	return vi_max(tick * INTERPOLATION_DELAY_MIN, vi_min(tick * INTERPOLATION_DELAY_MAX, delay));
 }
 
 #if SERVER
 namespace Server
 {
 	void packet_sent(const StreamWrite&, const Sock::Address&);
+	void packet_received(s32, const Sock::Address&);
 }
 #endif
 
@@ -165,6 +410,7 @@ void packet_send(const StreamWrite& p, const Sock::Address& address)
 {
 	Sock::udp_send(&state_persistent.sock, address, p.data.data, p.bytes_written());
 	state_common.bandwidth_out_counter += p.bytes_written();
+	stats_add(&state_common.stats_window.packets_out, p.bytes_written() * 8, 0);
 #if SERVER
 	Server::packet_sent(p, address);
 #endif
@@ -340,519 +586,666 @@ template<typename Stream> b8 serialize_constraint(Stream* p, RigidBody::Constrai
 	return true;
 }
 
-template<typename Stream> b8 serialize_entity(Stream* p, Entity* e)
-{
-	const ComponentMask mask = Transform::component_mask
-		| RigidBody::component_mask
-		| View::component_mask
-		| Animator::component_mask
-		| Rope::component_mask
-		| SpawnPoint::component_mask
-		| UpgradeStation::component_mask
-		| AIAgent::component_mask
-		| Health::component_mask
-		| PointLight::component_mask
-		| SpotLight::component_mask
-		| MinionSpawner::component_mask
-		| Walker::component_mask
-		| Turret::component_mask
-		| Ragdoll::component_mask
-		| Target::component_mask
-		| PlayerTrigger::component_mask
-		| SkinnedModel::component_mask
-		| Bolt::component_mask
-		| Grenade::component_mask
-		| Battery::component_mask
-		| Rectifier::component_mask
-		| ForceField::component_mask
-		| ForceFieldCollision::component_mask
-		| Drone::component_mask
-		| Shield::component_mask
-		| Audio::component_mask
-		| Team::component_mask
-		| PlayerHuman::component_mask
-		| PlayerManager::component_mask
-		| PlayerCommon::component_mask
-		| PlayerControlHuman::component_mask
-		| Minion::component_mask
-		| Parkour::component_mask
-		| Interactable::component_mask
-		| Tram::component_mask
-		| TramRunner::component_mask
-		| Collectible::component_mask
-		| Water::component_mask
-		| Flag::component_mask
-		| Glass::component_mask;
+// component schemas, in no particular order. see net_schema.h
+NET_SCHEMA(RigidBody,
+	Schema::field_vec3_range(&RigidBody::size, 0, 5.0f, 8),
+	Schema::field_vec2_range(&RigidBody::damping, 0, 1.0f, 2),
+	Schema::field_enum(&RigidBody::type),
+	Schema::field_r32_range(&RigidBody::mass, 0, 20.0f, 16),
+	Schema::field_r32_range(&RigidBody::restitution, 0, 1, 8),
+	Schema::field_asset(&RigidBody::mesh_id, &Loader::static_mesh_count),
+	Schema::field_s16(&RigidBody::collision_group),
+	Schema::field_s16(&RigidBody::collision_filter),
+	Schema::field_s8(&RigidBody::flags));
+NET_SCHEMA(AIAgent,
+	Schema::field_s8(&AIAgent::team));
+NET_SCHEMA(Drone,
+	Schema::field_r32_range(&Drone::cooldown, 0, DRONE_COOLDOWN_MAX, 8),
+	Schema::field_r32_range(&Drone::cooldown_ability_switch, 0, DRONE_COOLDOWN_ABILITY_SWITCH_MAX, 6),
+	Schema::field_int(&Drone::current_ability, 0, s32(Ability::count) + 1));
+NET_SCHEMA(Minion,
+	Schema::field_ref(&Minion::owner),
+	Schema::field_ref(&Minion::carrying));
+NET_SCHEMA(Turret,
+	Schema::field_s8(&Turret::team),
+	Schema::field_ref(&Turret::target),
+	Schema::field_ref(&Turret::owner));
+NET_SCHEMA(Flag,
+	Schema::field_s8(&Flag::team),
+	Schema::field_r32_range(&Flag::timer, 0.0f, FLAG_RESTORE_TIME, 16),
+	Schema::field_bool(&Flag::at_base));
+NET_SCHEMA(Health,
+	Schema::field_r32_range(&Health::active_armor_timer, 0, 5, 8),
+	Schema::field_r32_range(&Health::regen_timer, 0, 10, 8),
+	Schema::field_s8(&Health::shield),
+	Schema::field_s8(&Health::shield_max),
+	Schema::field_s8(&Health::hp),
+	Schema::field_s8(&Health::hp_max));
+NET_SCHEMA(Shield,
+	Schema::field_ref(&Shield::inner),
+	Schema::field_ref(&Shield::outer),
+	Schema::field_ref(&Shield::active_armor));
+NET_SCHEMA(MinionSpawner,
+	Schema::field_s8(&MinionSpawner::team),
+	Schema::field_ref(&MinionSpawner::owner));
+NET_SCHEMA(PointLight,
+	Schema::field_vec3_range(&PointLight::color, 0, 1, 8),
+	Schema::field_vec3_range(&PointLight::offset, -5, 5, 8),
+	Schema::field_r32_range(&PointLight::radius, 0, 50, 8),
+	Schema::field_enum(&PointLight::type),
+	Schema::field_s16(&PointLight::mask),
+	Schema::field_s8(&PointLight::team));
+NET_SCHEMA(SpotLight,
+	Schema::field_vec3_range(&SpotLight::color, 0, 1, 8),
+	Schema::field_r32_range(&SpotLight::radius, 0, 50, 8),
+	Schema::field_r32_range(&SpotLight::fov, 0, PI, 8),
+	Schema::field_s16(&SpotLight::mask),
+	Schema::field_s8(&SpotLight::team));
+NET_SCHEMA(SpawnPoint,
+	Schema::field_s8(&SpawnPoint::team));
+NET_SCHEMA(UpgradeStation,
+	Schema::field_ref(&UpgradeStation::spawn_point),
+	Schema::field_ref(&UpgradeStation::drone),
+	Schema::field_enum(&UpgradeStation::mode));
+NET_SCHEMA(Target,
+	Schema::field_vec3_range(&Target::local_offset, -5, 5, 16));
+NET_SCHEMA(PlayerTrigger,
+	Schema::field_r32(&PlayerTrigger::radius));
+NET_SCHEMA(Bolt,
+	Schema::field_s8(&Bolt::team),
+	Schema::field_ref(&Bolt::owner),
+	Schema::field_ref(&Bolt::player),
+	Schema::field_vec3(&Bolt::velocity),
+	Schema::field_enum(&Bolt::type),
+	Schema::field_bool(&Bolt::reflected));
+NET_SCHEMA(Grenade,
+	Schema::field_ref(&Grenade::owner),
+	Schema::field_enum(&Grenade::state),
+	Schema::field_s8(&Grenade::team));
+NET_SCHEMA(Battery,
+	Schema::field_s8(&Battery::team),
+	Schema::field_ref(&Battery::light),
+	Schema::field_ref(&Battery::spawn_point),
+	Schema::field_s16(&Battery::energy));
+NET_SCHEMA(Rectifier,
+	Schema::field_s8(&Rectifier::team),
+	Schema::field_ref(&Rectifier::owner));
+NET_SCHEMA(ForceField,
+	Schema::field_ref(&ForceField::collision),
+	Schema::field_s8(&ForceField::team),
+	Schema::field_s8(&ForceField::flags));
+NET_SCHEMA(ForceFieldCollision,
+	Schema::field_ref(&ForceFieldCollision::field));
+NET_SCHEMA(Team,
+	Schema::field_s16(&Team::kills),
+	Schema::field_s16(&Team::flags_captured),
+	Schema::field_s16(&Team::energy_collected),
+	Schema::field_ref(&Team::flag_base));
+NET_SCHEMA(PlayerCommon,
+	Schema::field_r32_range(&PlayerCommon::angle_horizontal, PI * -2.0f, PI * 2.0f, 16),
+	Schema::field_r32_range(&PlayerCommon::angle_vertical, -PI, PI, 16),
+	Schema::field_ref(&PlayerCommon::manager));
+NET_SCHEMA(PlayerControlHuman,
+	Schema::field_ref(&PlayerControlHuman::player));
+NET_SCHEMA(Interactable,
+	Schema::field_s32(&Interactable::user_data),
+	Schema::field_enum(&Interactable::type));
+NET_SCHEMA(Tram,
+	Schema::field_ref(&Tram::runner_a),
+	Schema::field_ref(&Tram::runner_b),
+	Schema::field_ref(&Tram::doors),
+	Schema::field_bool(&Tram::departing),
+	Schema::field_bool(&Tram::arrive_only));
+NET_SCHEMA(TramRunner,
+	Schema::field_s8(&TramRunner::track),
+	Schema::field_bool(&TramRunner::is_front),
+	Schema::field_enum(&TramRunner::state));
+NET_SCHEMA(Collectible,
+	Schema::field_s16(&Collectible::save_id),
+	Schema::field_enum(&Collectible::type),
+	Schema::field_s16(&Collectible::amount));
+
+// components with a schema.
+// base is the prefab default for this component, if the entity is being sent as a prefab
+template<typename Stream, typename T> b8 serialize_component(Stream* p, T* c, const T* base)
+{
+	if (base)
+		return Schema::serialize_delta(p, c, base, NetSchema<T>::fields());
+	else
+		return Schema::serialize(p, c, NetSchema<T>::fields());
+}
+
+// components that need more than a schema. other than RigidBody, these ignore any prefab base
 
+template<typename Stream> b8 serialize_component(Stream* p, Transform* t, const Transform*)
+{
+	if (!serialize_position(p, &t->pos, Resolution::High))
+		net_error();
+	b8 is_identity_quat;
 	if (Stream::IsWriting)
+		is_identity_quat = Quat::angle(t->rot, Quat::identity) == 0.0f;
+	serialize_bool(p, is_identity_quat);
+	if (!is_identity_quat)
 	{
-		ComponentMask m = e->component_mask;
-		m &= mask;
-		serialize_u64(p, m);
+		if (!serialize_quat(p, &t->rot, Resolution::High))
+			net_error();
 	}
-	else
-		serialize_u64(p, e->component_mask);
-	serialize_s16(p, e->revision);
+	else if (Stream::IsReading)
+		t->rot = Quat::identity;
+	serialize_ref(p, t->parent);
+	return true;
+}
 
-#if DEBUG_ENTITY
+template<typename Stream> b8 serialize_component(Stream* p, RigidBody* r, const RigidBody* base)
+{
+	if (base)
 	{
-		char components[MAX_FAMILIES + 1] = {};
-		for (s32 i = 0; i < MAX_FAMILIES; i++)
-			components[i] = (e->component_mask & (ComponentMask(1) << i) & mask) ? '1' : '0';
-		vi_debug("Entity %d rev %d: %s", s32(e->id()), s32(e->revision), components);
+		if (!Schema::serialize_delta(p, r, base, NetSchema<RigidBody>::fields()))
+			net_error();
+	}
+	else
+	{
+		if (!Schema::serialize(p, r, NetSchema<RigidBody>::fields()))
+			net_error();
 	}
-#endif
 
-	for (s32 i = 0; i < MAX_FAMILIES; i++)
+	if (Stream::IsWriting)
 	{
-		if (e->component_mask & mask & (ComponentMask(1) << i))
+		b8 b = false;
+		for (auto i = RigidBody::global_constraints.iterator(); !i.is_last(); i.next())
 		{
-			serialize_int(p, ID, e->components[i], 0, MAX_ENTITIES - 1);
-			ID component_id = e->components[i];
-			Revision r;
-			if (Stream::IsWriting)
-				r = World::component_pools[i]->revision(component_id);
-			serialize_s16(p, r);
-			if (Stream::IsReading)
-				World::component_pools[i]->net_add(component_id, e->id(), r);
+			RigidBody::Constraint* c = i.item();
+			if (c->a.ref() == r)
+			{
+				b = true;
+				serialize_bool(p, b);
+				if (!serialize_constraint(p, c))
+					net_error();
+			}
 		}
+		b = false;
+		serialize_bool(p, b);
 	}
-
-	if (e->has<Transform>())
+	else
 	{
-		Transform* t = e->get<Transform>();
-		if (!serialize_position(p, &t->pos, Resolution::High))
-			net_error();
-		b8 is_identity_quat;
-		if (Stream::IsWriting)
-			is_identity_quat = Quat::angle(t->rot, Quat::identity) == 0.0f;
-		serialize_bool(p, is_identity_quat);
-		if (!is_identity_quat)
+		b8 has_constraint;
+		serialize_bool(p, has_constraint);
+		while (has_constraint)
 		{
-			if (!serialize_quat(p, &t->rot, Resolution::High))
+			RigidBody::Constraint* c = RigidBody::net_add_constraint();
+			c->a = r;
+			c->btPointer = nullptr;
+
+			if (!serialize_constraint(p, c))
 				net_error();
+
+			serialize_bool(p, has_constraint);
 		}
-		else if (Stream::IsReading)
-			t->rot = Quat::identity;
-		serialize_ref(p, t->parent);
 	}
+	return true;
+}
 
-	if (e->has<RigidBody>())
-	{
-		RigidBody* r = e->get<RigidBody>();
-		serialize_r32_range(p, r->size.x, 0, 5.0f, 8);
-		serialize_r32_range(p, r->size.y, 0, 5.0f, 8);
-		serialize_r32_range(p, r->size.z, 0, 5.0f, 8);
-		serialize_r32_range(p, r->damping.x, 0, 1.0f, 2);
-		serialize_r32_range(p, r->damping.y, 0, 1.0f, 2);
-		serialize_enum(p, RigidBody::Type, r->type);
-		serialize_r32_range(p, r->mass, 0, 20.0f, 16);
-		serialize_r32_range(p, r->restitution, 0, 1, 8);
-		serialize_asset(p, r->mesh_id, Loader::static_mesh_count);
-		serialize_s16(p, r->collision_group);
-		serialize_s16(p, r->collision_filter);
-		serialize_s8(p, r->flags);
+template<typename Stream> b8 serialize_component(Stream* p, View* v, const View*)
+{
+	return serialize_view_skinnedmodel(p, v);
+}
 
-		if (Stream::IsWriting)
+template<typename Stream> b8 serialize_component(Stream* p, Animator* a, const Animator*)
+{
+	for (s32 i = 0; i < MAX_ANIMATIONS; i++)
+	{
+		Animator::Layer* l = &a->layers[i];
+		serialize_r32_range(p, l->blend, 0, 1, 8);
+		serialize_r32_range(p, l->blend_time, 0, 8, 16);
+		serialize_r32(p, l->time);
+		serialize_r32_range(p, l->speed, 0, 8, 16);
+		serialize_asset(p, l->animation, Loader::animation_count);
+		if (Stream::IsReading)
 		{
-			b8 b = false;
-			for (auto i = RigidBody::global_constraints.iterator(); !i.is_last(); i.next())
-			{
-				RigidBody::Constraint* c = i.item();
-				if (c->a.ref() == r)
-				{
-					b = true;
-					serialize_bool(p, b);
-					if (!serialize_constraint(p, c))
-						net_error();
-				}
-			}
-			b = false;
-			serialize_bool(p, b);
+			l->last_animation = l->last_frame_animation = l->animation;
+			l->time_last = l->time;
 		}
-		else
-		{
-			b8 has_constraint;
-			serialize_bool(p, has_constraint);
-			while (has_constraint)
-			{
-				RigidBody::Constraint* c = RigidBody::net_add_constraint();
-				c->a = r;
-				c->btPointer = nullptr;
-
-				if (!serialize_constraint(p, c))
-					net_error();
+		serialize_enum(p, Animator::Behavior, l->behavior);
+	}
+	serialize_asset(p, a->armature, Loader::armature_count);
+	serialize_enum(p, Animator::OverrideMode, a->override_mode);
+	return true;
+}
 
-				serialize_bool(p, has_constraint);
-			}
-		}
+template<typename Stream> b8 serialize_component(Stream* p, Walker* w, const Walker*)
+{
+	serialize_r32_range(p, w->speed, 0, 10, 16);
+	serialize_r32_range(p, w->max_speed, 0, 10, 16);
+	serialize_bool(p, w->auto_rotate);
+	r32 r;
+	if (Stream::IsWriting)
+		r = LMath::angle_range(w->rotation);
+	serialize_r32_range(p, r, -PI, PI, 8);
+	if (Stream::IsReading)
+	{
+		w->rotation = r;
+		w->target_rotation = r;
 	}
+	return true;
+}
 
-	if (e->has<View>())
+template<typename Stream> b8 serialize_component(Stream* p, Ragdoll* r, const Ragdoll*)
+{
+	serialize_enum(p, Ragdoll::Impulse, r->impulse_type);
+	serialize_r32_range(p, r->impulse.x, -15.0f, 15.0f, 8);
+	serialize_r32_range(p, r->impulse.y, -15.0f, 15.0f, 8);
+	serialize_r32_range(p, r->impulse.z, -15.0f, 15.0f, 8);
+	s32 bone_count;
+	if (Stream::IsWriting)
+		bone_count = r->bodies.length;
+	serialize_int(p, s32, bone_count, 0, MAX_BONES);
+	if (Stream::IsReading)
+		r->bodies.resize(bone_count);
+	for (s32 i = 0; i < bone_count; i++)
 	{
-		if (!serialize_view_skinnedmodel(p, e->get<View>()))
+		Ragdoll::BoneBody* bone = &r->bodies[i];
+		serialize_ref(p, bone->body);
+		serialize_asset(p, bone->bone, Asset::Bone::count);
+		if (!serialize_position(p, &bone->body_to_bone_pos, Resolution::Medium))
+			net_error();
+		if (!serialize_quat(p, &bone->body_to_bone_rot, Resolution::Medium))
 			net_error();
 	}
+	return true;
+}
+
+template<typename Stream> b8 serialize_component(Stream* p, SkinnedModel* s, const SkinnedModel*)
+{
+	if (!serialize_view_skinnedmodel(p, s))
+		net_error();
+	serialize_asset(p, s->mesh_first_person, Loader::static_mesh_count);
+	return true;
+}
 
-	if (e->has<Animator>())
+template<typename Stream> b8 serialize_component(Stream* p, Water* w, const Water*)
+{
+	serialize_r32_range(p, w->config.color.x, 0, 1.0f, 8);
+	serialize_r32_range(p, w->config.color.y, 0, 1.0f, 8);
+	serialize_r32_range(p, w->config.color.z, 0, 1.0f, 8);
+	serialize_r32_range(p, w->config.color.w, 0, 1.0f, 8);
+	serialize_r32_range(p, w->config.displacement_horizontal, 0, 10, 8);
+	serialize_r32_range(p, w->config.displacement_vertical, 0, 10, 8);
+	serialize_s16(p, w->config.mesh);
+	serialize_bool(p, w->config.ocean);
+	serialize_asset(p, w->config.texture, Loader::static_texture_count);
+	return true;
+}
+
+template<typename Stream> b8 serialize_component(Stream* p, PlayerHuman* ph, const PlayerHuman*)
+{
+	serialize_u64(p, ph->uuid);
+	serialize_u32(p, ph->master_id);
+	if (Stream::IsReading)
 	{
-		Animator* a = e->get<Animator>();
-		for (s32 i = 0; i < MAX_ANIMATIONS; i++)
+		ph->flag(PlayerHuman::FlagLocal, false);
+#if !SERVER // when replaying, all players are remote
+		if (Client::replay_mode() == Client::ReplayMode::Replaying)
+			ph->gamepad = s8(ph->id());
+		else
+#endif
 		{
-			Animator::Layer* l = &a->layers[i];
-			serialize_r32_range(p, l->blend, 0, 1, 8);
-			serialize_r32_range(p, l->blend_time, 0, 8, 16);
-			serialize_r32(p, l->time);
-			serialize_r32_range(p, l->speed, 0, 8, 16);
-			serialize_asset(p, l->animation, Loader::animation_count);
-			if (Stream::IsReading)
+			for (s32 i = 0; i < MAX_GAMEPADS; i++)
 			{
-				l->last_animation = l->last_frame_animation = l->animation;
-				l->time_last = l->time;
+				if (ph->uuid == Game::session.local_player_uuids[i])
+				{
+					ph->flag(PlayerHuman::FlagLocal, true);
+					ph->gamepad = s8(i);
+					break;
+				}
 			}
-			serialize_enum(p, Animator::Behavior, l->behavior);
 		}
-		serialize_asset(p, a->armature, Loader::armature_count);
-		serialize_enum(p, Animator::OverrideMode, a->override_mode);
 	}
+	return true;
+}
 
-	if (e->has<AIAgent>())
-	{
-		AIAgent* a = e->get<AIAgent>();
-		serialize_s8(p, a->team);
-	}
+template<typename Stream> b8 serialize_component(Stream* p, PlayerManager* m, const PlayerManager*)
+{
+	serialize_s32(p, m->upgrades);
+	for (s32 i = 0; i < MAX_ABILITIES; i++)
+		serialize_int(p, Ability, m->abilities[i], 0, s32(Ability::count) + 1);
+	serialize_ref(p, m->team);
+	serialize_ref(p, m->instance);
+	serialize_s16(p, m->energy);
+	serialize_s16(p, m->kills);
+	serialize_s16(p, m->deaths);
+	serialize_s16(p, m->flags_captured);
+	serialize_s16(p, m->energy_collected);
+	s32 username_length;
+	if (Stream::IsWriting)
+		username_length = s32(strlen(m->username));
+	serialize_int(p, s32, username_length, 0, MAX_USERNAME);
+	serialize_bytes(p, (u8*)m->username, username_length);
+	if (Stream::IsReading)
+		m->username[username_length] = '\0';
+	serialize_s8(p, m->flags);
+	return true;
+}
 
-	if (e->has<Drone>())
-	{
-		Drone* a = e->get<Drone>();
-		serialize_r32_range(p, a->cooldown, 0, DRONE_COOLDOWN_MAX, 8);
-		serialize_r32_range(p, a->cooldown_ability_switch, 0, DRONE_COOLDOWN_ABILITY_SWITCH_MAX, 6);
-		serialize_int(p, Ability, a->current_ability, 0, s32(Ability::count) + 1);
-	}
+// replicated for their presence only
+template<typename Stream> b8 serialize_component(Stream*, Rope*, const Rope*)
+{
+	return true;
+}
 
-	if (e->has<Minion>())
-	{
-		Minion* m = e->get<Minion>();
-		serialize_ref(p, m->owner);
-		serialize_ref(p, m->carrying);
-	}
+template<typename Stream> b8 serialize_component(Stream*, Audio*, const Audio*)
+{
+	return true;
+}
 
-	if (e->has<Turret>())
-	{
-		Turret* t = e->get<Turret>();
-		serialize_s8(p, t->team);
-		serialize_ref(p, t->target);
-		serialize_ref(p, t->owner);
-	}
+template<typename Stream> b8 serialize_component(Stream*, Parkour*, const Parkour*)
+{
+	return true;
+}
 
-	if (e->has<Flag>())
-	{
-		Flag* f = e->get<Flag>();
-		serialize_s8(p, f->team);
-		serialize_r32_range(p, f->timer, 0.0f, FLAG_RESTORE_TIME, 16);
-		serialize_bool(p, f->at_base);
-	}
+template<typename Stream> b8 serialize_component(Stream*, Glass*, const Glass*)
+{
+	return true;
+}
 
-	if (e->has<Health>())
-	{
-		Health* h = e->get<Health>();
-		serialize_r32_range(p, h->active_armor_timer, 0, 5, 8);
-		serialize_r32_range(p, h->regen_timer, 0, 10, 8);
-		serialize_s8(p, h->shield);
-		serialize_s8(p, h->shield_max);
-		serialize_s8(p, h->hp);
-		serialize_s8(p, h->hp_max);
-	}
+// default values of one component type for each prefab. see prefab_init
+template<typename T> struct PrefabBase
+{
+	static const T* list[s32(Prefab::count)];
 
-	if (e->has<Shield>())
+	static const T* get(Prefab prefab)
 	{
-		Shield* s = e->get<Shield>();
-		serialize_ref(p, s->inner);
-		serialize_ref(p, s->outer);
-		serialize_ref(p, s->active_armor);
+		return list[s32(prefab)];
 	}
+};
 
-	if (e->has<MinionSpawner>())
-	{
-		MinionSpawner* m = e->get<MinionSpawner>();
-		serialize_s8(p, m->team);
-		serialize_ref(p, m->owner);
-	}
+template<typename T> const T* PrefabBase<T>::list[s32(Prefab::count)];
 
-	if (e->has<PointLight>())
-	{
-		PointLight* l = e->get<PointLight>();
-		serialize_r32_range(p, l->color.x, 0, 1, 8);
-		serialize_r32_range(p, l->color.y, 0, 1, 8);
-		serialize_r32_range(p, l->color.z, 0, 1, 8);
-		serialize_r32_range(p, l->offset.x, -5, 5, 8);
-		serialize_r32_range(p, l->offset.y, -5, 5, 8);
-		serialize_r32_range(p, l->offset.z, -5, 5, 8);
-		serialize_r32_range(p, l->radius, 0, 50, 8);
-		serialize_enum(p, PointLight::Type, l->type);
-		serialize_s16(p, l->mask);
-		serialize_s8(p, l->team);
-	}
+template<typename T> T* prefab_base_add(Prefab prefab)
+{
+	// never freed; component destructors expect to belong to a live entity.
+	// component pools are zero-initialized, and constructors leave some fields (Health::active_armor_timer)
+	// to that, so zero the base too or it would diff against garbage
+	void* storage = operator new(sizeof(T));
+	memset(storage, 0, sizeof(T));
+	T* c = new (storage) T();
+	PrefabBase<T>::list[s32(prefab)] = c;
+	return c;
+}
 
-	if (e->has<SpotLight>())
+// must match the entity constructors (BoltEntity, GrenadeEntity, etc.) closely enough to be worth it.
+// anything that doesn't match is just sent in full.
+// components without a schema are always sent in full, so they don't get a base
+void prefab_init()
+{
 	{
-		SpotLight* l = e->get<SpotLight>();
-		serialize_r32_range(p, l->color.x, 0, 1, 8);
-		serialize_r32_range(p, l->color.y, 0, 1, 8);
-		serialize_r32_range(p, l->color.z, 0, 1, 8);
-		serialize_r32_range(p, l->radius, 0, 50, 8);
-		serialize_r32_range(p, l->fov, 0, PI, 8);
-		serialize_s16(p, l->mask);
-		serialize_s8(p, l->team);
-	}
+		PointLight* light = prefab_base_add<PointLight>(Prefab::Bolt);
+		light->radius = BOLT_LIGHT_RADIUS;
+		light->color = Team::color_neutral().xyz();
 
-	if (e->has<SpawnPoint>())
-	{
-		SpawnPoint* s = e->get<SpawnPoint>();
-		serialize_s8(p, s->team);
+		prefab_base_add<Bolt>(Prefab::Bolt)->team = AI::TeamNone;
 	}
 
-	if (e->has<UpgradeStation>())
 	{
-		UpgradeStation* u = e->get<UpgradeStation>();
-		serialize_ref(p, u->spawn_point);
-		serialize_ref(p, u->drone);
-		serialize_enum(p, UpgradeStation::Mode, u->mode);
-	}
+		Grenade* g = prefab_base_add<Grenade>(Prefab::Grenade);
+		g->team = AI::TeamNone;
 
-	if (e->has<Walker>())
-	{
-		Walker* w = e->get<Walker>();
-		serialize_r32_range(p, w->speed, 0, 10, 16);
-		serialize_r32_range(p, w->max_speed, 0, 10, 16);
-		serialize_bool(p, w->auto_rotate);
-		r32 r;
-		if (Stream::IsWriting)
-			r = LMath::angle_range(w->rotation);
-		serialize_r32_range(p, r, -PI, PI, 8);
-		if (Stream::IsReading)
-		{
-			w->rotation = r;
-			w->target_rotation = r;
-		}
-	}
+		RigidBody* body = prefab_base_add<RigidBody>(Prefab::Grenade);
+		body->type = RigidBody::Type::Sphere;
+		body->size = Vec3(GRENADE_RADIUS * 2.0f);
+		body->collision_group = CollisionTarget;
+		body->collision_filter = GRENADE_COLLISION_FILTER;
 
-	if (e->has<Ragdoll>())
-	{
-		Ragdoll* r = e->get<Ragdoll>();
-		serialize_enum(p, Ragdoll::Impulse, r->impulse_type);
-		serialize_r32_range(p, r->impulse.x, -15.0f, 15.0f, 8);
-		serialize_r32_range(p, r->impulse.y, -15.0f, 15.0f, 8);
-		serialize_r32_range(p, r->impulse.z, -15.0f, 15.0f, 8);
-		s32 bone_count;
-		if (Stream::IsWriting)
-			bone_count = r->bodies.length;
-		serialize_int(p, s32, bone_count, 0, MAX_BONES);
-		if (Stream::IsReading)
-			r->bodies.resize(bone_count);
-		for (s32 i = 0; i < bone_count; i++)
-		{
-			Ragdoll::BoneBody* bone = &r->bodies[i];
-			serialize_ref(p, bone->body);
-			serialize_asset(p, bone->bone, Asset::Bone::count);
-			if (!serialize_position(p, &bone->body_to_bone_pos, Resolution::Medium))
-				net_error();
-			if (!serialize_quat(p, &bone->body_to_bone_rot, Resolution::Medium))
-				net_error();
-		}
-	}
+		PointLight* light = prefab_base_add<PointLight>(Prefab::Grenade);
+		light->radius = BOLT_LIGHT_RADIUS;
+		light->color = Team::color_neutral().xyz();
 
-	if (e->has<Target>())
-	{
-		Target* t = e->get<Target>();
-		serialize_r32_range(p, t->local_offset.x, -5, 5, 16);
-		serialize_r32_range(p, t->local_offset.y, -5, 5, 16);
-		serialize_r32_range(p, t->local_offset.z, -5, 5, 16);
-	}
+		Health* health = prefab_base_add<Health>(Prefab::Grenade);
+		health->hp = health->hp_max = GRENADE_HEALTH;
 
-	if (e->has<PlayerTrigger>())
-	{
-		PlayerTrigger* t = e->get<PlayerTrigger>();
-		serialize_r32(p, t->radius);
+		prefab_base_add<Target>(Prefab::Grenade);
 	}
 
-	if (e->has<SkinnedModel>())
 	{
-		SkinnedModel* s = e->get<SkinnedModel>();
-		if (!serialize_view_skinnedmodel(p, s))
-			net_error();
-		serialize_asset(p, s->mesh_first_person, Loader::static_mesh_count);
+		Health* health = prefab_base_add<Health>(Prefab::Minion);
+		health->hp = health->hp_max = MINION_HEALTH;
+
+		prefab_base_add<Minion>(Prefab::Minion);
+		prefab_base_add<AIAgent>(Prefab::Minion)->team = AI::TeamNone;
+		prefab_base_add<Target>(Prefab::Minion);
 	}
 
-	if (e->has<Bolt>())
 	{
-		Bolt* x = e->get<Bolt>();
-		serialize_s8(p, x->team);
-		serialize_ref(p, x->owner);
-		serialize_ref(p, x->player);
-		serialize_r32(p, x->velocity.x);
-		serialize_r32(p, x->velocity.y);
-		serialize_r32(p, x->velocity.z);
-		serialize_enum(p, Bolt::Type, x->type);
-		serialize_bool(p, x->reflected);
+		prefab_base_add<Rectifier>(Prefab::Battery);
+		prefab_base_add<Target>(Prefab::Battery);
+
+		Health* health = prefab_base_add<Health>(Prefab::Battery);
+		health->hp = health->hp_max = BATTERY_HEALTH;
+
+		Battery* battery = prefab_base_add<Battery>(Prefab::Battery);
+		battery->team = AI::TeamNone;
+		battery->energy = BATTERY_ENERGY;
+
+		RigidBody* body = prefab_base_add<RigidBody>(Prefab::Battery);
+		body->type = RigidBody::Type::Sphere;
+		body->size = Vec3(BATTERY_RADIUS);
+		body->mass = 0.1f;
+		body->collision_group = CollisionTarget;
+		body->collision_filter = BATTERY_COLLISION_FILTER;
+		body->damping = Vec2(0.5f, 0.5f);
+		body->flags = RigidBody::FlagContinuousCollisionDetection;
 	}
 
-	if (e->has<Grenade>())
 	{
-		Grenade* g = e->get<Grenade>();
-		serialize_ref(p, g->owner);
-		serialize_enum(p, Grenade::State, g->state);
-		serialize_s8(p, g->team);
+		prefab_base_add<Turret>(Prefab::Turret)->team = AI::TeamNone;
+		prefab_base_add<Target>(Prefab::Turret);
+
+		Health* health = prefab_base_add<Health>(Prefab::Turret);
+		health->hp = health->hp_max = TURRET_HEALTH;
+		health->shield = health->shield_max = DRONE_SHIELD_AMOUNT;
+
+		prefab_base_add<Shield>(Prefab::Turret);
+
+		PointLight* light = prefab_base_add<PointLight>(Prefab::Turret);
+		light->color = Team::color_neutral().xyz();
+		light->radius = TURRET_RANGE * 0.5f;
 	}
+}
 
-	if (e->has<Battery>())
+// the exact set of replicated components an entity must have to be sent as the given prefab
+ComponentMask prefab_mask(Prefab prefab)
+{
+	switch (prefab)
 	{
-		Battery* b = e->get<Battery>();
-		serialize_s8(p, b->team);
-		serialize_ref(p, b->light);
-		serialize_ref(p, b->spawn_point);
-		serialize_s16(p, b->energy);
+		case Prefab::Bolt:
+			return Transform::component_mask
+				| PointLight::component_mask
+				| Bolt::component_mask;
+		case Prefab::Grenade:
+			return Transform::component_mask
+				| Audio::component_mask
+				| Grenade::component_mask
+				| RigidBody::component_mask
+				| PointLight::component_mask
+				| View::component_mask
+				| Health::component_mask
+				| Target::component_mask;
+		case Prefab::Minion:
+			return Transform::component_mask
+				| Animator::component_mask
+				| SkinnedModel::component_mask
+				| Audio::component_mask
+				| Health::component_mask
+				| Walker::component_mask
+				| Minion::component_mask
+				| AIAgent::component_mask
+				| Target::component_mask;
+		case Prefab::Battery:
+			return Transform::component_mask
+				| View::component_mask
+				| Rectifier::component_mask
+				| Target::component_mask
+				| Health::component_mask
+				| Battery::component_mask
+				| RigidBody::component_mask;
+		case Prefab::Turret:
+			return Transform::component_mask
+				| Audio::component_mask
+				| View::component_mask
+				| Turret::component_mask
+				| Target::component_mask
+				| Health::component_mask
+				| Shield::component_mask
+				| PointLight::component_mask;
+		default:
+			return 0;
 	}
+}
 
-	if (e->has<Rectifier>())
+Prefab prefab_match(ComponentMask mask)
+{
+	for (s32 i = s32(Prefab::None) + 1; i < s32(Prefab::count); i++)
 	{
-		Rectifier* s = e->get<Rectifier>();
-		serialize_s8(p, s->team);
-		serialize_ref(p, s->owner);
+		if (prefab_mask(Prefab(i)) == mask)
+			return Prefab(i);
 	}
+	return Prefab::None;
+}
+
+template<typename... T> struct ComponentList;
 
-	if (e->has<ForceField>())
+template<> struct ComponentList<>
+{
+	static ComponentMask mask()
 	{
-		ForceField* c = e->get<ForceField>();
-		serialize_ref(p, c->collision);
-		serialize_s8(p, c->team);
-		serialize_s8(p, c->flags);
+		return 0;
 	}
 
-	if (e->has<ForceFieldCollision>())
+	template<typename Stream> static b8 serialize(Stream*, Entity*, Prefab)
 	{
-		ForceFieldCollision* c = e->get<ForceFieldCollision>();
-		serialize_ref(p, c->field);
+		return true;
 	}
+};
 
-	if (e->has<Water>())
+template<typename T, typename... Rest> struct ComponentList<T, Rest...>
+{
+	static ComponentMask mask()
 	{
-		Water* w = e->get<Water>();
-		serialize_r32_range(p, w->config.color.x, 0, 1.0f, 8);
-		serialize_r32_range(p, w->config.color.y, 0, 1.0f, 8);
-		serialize_r32_range(p, w->config.color.z, 0, 1.0f, 8);
-		serialize_r32_range(p, w->config.color.w, 0, 1.0f, 8);
-		serialize_r32_range(p, w->config.displacement_horizontal, 0, 10, 8);
-		serialize_r32_range(p, w->config.displacement_vertical, 0, 10, 8);
-		serialize_s16(p, w->config.mesh);
-		serialize_bool(p, w->config.ocean);
-		serialize_asset(p, w->config.texture, Loader::static_texture_count);
+		return T::component_mask | ComponentList<Rest...>::mask();
 	}
 
-	if (e->has<PlayerHuman>())
+	template<typename Stream> static b8 serialize(Stream* p, Entity* e, Prefab prefab)
 	{
-		PlayerHuman* ph = e->get<PlayerHuman>();
-		serialize_u64(p, ph->uuid);
-		serialize_u32(p, ph->master_id);
-		if (Stream::IsReading)
+		if (e->has<T>())
 		{
-			ph->flag(PlayerHuman::FlagLocal, false);
-#if !SERVER // when replaying, all players are remote
-			if (Client::replay_mode() == Client::ReplayMode::Replaying)
-				ph->gamepad = s8(ph->id());
-			else
-#endif
-			{
-				for (s32 i = 0; i < MAX_GAMEPADS; i++)
-				{
-					if (ph->uuid == Game::session.local_player_uuids[i])
-					{
-						ph->flag(PlayerHuman::FlagLocal, true);
-						ph->gamepad = s8(i);
-						break;
-					}
-				}
-			}
+			if (!serialize_component(p, e->get<T>(), PrefabBase<T>::get(prefab)))
+				net_error();
 		}
+		return ComponentList<Rest...>::serialize(p, e, prefab);
 	}
+};
 
-	if (e->has<PlayerManager>())
-	{
-		PlayerManager* m = e->get<PlayerManager>();
-		serialize_s32(p, m->upgrades);
-		for (s32 i = 0; i < MAX_ABILITIES; i++)
-			serialize_int(p, Ability, m->abilities[i], 0, s32(Ability::count) + 1);
-		serialize_ref(p, m->team);
-		serialize_ref(p, m->instance);
-		serialize_s16(p, m->energy);
-		serialize_s16(p, m->kills);
-		serialize_s16(p, m->deaths);
-		serialize_s16(p, m->flags_captured);
-		serialize_s16(p, m->energy_collected);
-		s32 username_length;
-		if (Stream::IsWriting)
-			username_length = s32(strlen(m->username));
-		serialize_int(p, s32, username_length, 0, MAX_USERNAME);
-		serialize_bytes(p, (u8*)m->username, username_length);
-		if (Stream::IsReading)
-			m->username[username_length] = '\0';
-		serialize_s8(p, m->flags);
-	}
+// every replicated component, in wire order
+typedef ComponentList
+<
+	Transform,
+	RigidBody,
+	View,
+	Animator,
+	AIAgent,
+	Drone,
+	Minion,
+	Turret,
+	Flag,
+	Health,
+	Shield,
+	MinionSpawner,
+	PointLight,
+	SpotLight,
+	SpawnPoint,
+	UpgradeStation,
+	Walker,
+	Ragdoll,
+	Target,
+	PlayerTrigger,
+	SkinnedModel,
+	Bolt,
+	Grenade,
+	Battery,
+	Rectifier,
+	ForceField,
+	ForceFieldCollision,
+	Water,
+	PlayerHuman,
+	PlayerManager,
+	Team,
+	PlayerCommon,
+	PlayerControlHuman,
+	Interactable,
+	Tram,
+	TramRunner,
+	Collectible,
+	Rope,
+	Audio,
+	Parkour,
+	Glass
+> ReplicatedComponents;
 
-	if (e->has<Team>())
-	{
-		Team* t = e->get<Team>();
-		serialize_s16(p, t->kills);
-		serialize_s16(p, t->flags_captured);
-		serialize_s16(p, t->energy_collected);
-		serialize_ref(p, t->flag_base);
-	}
+template<typename Stream> b8 serialize_entity(Stream* p, Entity* e)
+{
+	const ComponentMask mask = ReplicatedComponents::mask();
 
-	if (e->has<PlayerCommon>())
-	{
-		PlayerCommon* pc = e->get<PlayerCommon>();
-		serialize_r32_range(p, pc->angle_horizontal, PI * -2.0f, PI * 2.0f, 16);
-		serialize_r32_range(p, pc->angle_vertical, -PI, PI, 16);
-		serialize_ref(p, pc->manager);
-	}
+	s32 start_bits = stream_bits(p);
+	u64 start_time = stats_clock();
 
-	if (e->has<PlayerControlHuman>())
+	Prefab prefab;
+	if (Stream::IsWriting)
+		prefab = prefab_match(e->component_mask & mask);
+	serialize_enum(p, Prefab, prefab);
+	if (prefab == Prefab::None)
 	{
-		PlayerControlHuman* c = e->get<PlayerControlHuman>();
-		serialize_ref(p, c->player);
+		if (Stream::IsWriting)
+		{
+			ComponentMask m = e->component_mask;
+			m &= mask;
+			serialize_u64(p, m);
+		}
+		else
+			serialize_u64(p, e->component_mask);
 	}
+	else if (Stream::IsReading)
+		e->component_mask = prefab_mask(prefab);
+	serialize_s16(p, e->revision);
 
-	if (e->has<Interactable>())
+#if DEBUG_ENTITY
 	{
-		Interactable* i = e->get<Interactable>();
-		serialize_s32(p, i->user_data);
-		serialize_enum(p, Interactable::Type, i->type);
+		char components[MAX_FAMILIES + 1] = {};
+		for (s32 i = 0; i < MAX_FAMILIES; i++)
+			components[i] = (e->component_mask & (ComponentMask(1) << i) & mask) ? '1' : '0';
+		vi_debug("Entity %d rev %d: %s", s32(e->id()), s32(e->revision), components);
 	}
+#endif
 
-	if (e->has<Tram>())
+	for (s32 i = 0; i < MAX_FAMILIES; i++)
 	{
-		Tram* t = e->get<Tram>();
-		serialize_ref(p, t->runner_a);
-		serialize_ref(p, t->runner_b);
-		serialize_ref(p, t->doors);
-		serialize_bool(p, t->departing);
-		serialize_bool(p, t->arrive_only);
+		if (e->component_mask & mask & (ComponentMask(1) << i))
+		{
+			serialize_int(p, ID, e->components[i], 0, MAX_ENTITIES - 1);
+			ID component_id = e->components[i];
+			Revision r;
+			if (Stream::IsWriting)
+				r = World::component_pools[i]->revision(component_id);
+			serialize_s16(p, r);
+			if (Stream::IsReading)
+				World::component_pools[i]->net_add(component_id, e->id(), r);
+		}
 	}
 
-	if (e->has<TramRunner>())
-	{
-		TramRunner* r = e->get<TramRunner>();
-		serialize_s8(p, r->track);
-		serialize_bool(p, r->is_front);
-		serialize_enum(p, TramRunner::State, r->state);
-	}
+	if (!ReplicatedComponents::serialize(p, e, prefab))
+		net_error();
 
-	if (e->has<Collectible>())
 	{
-		Collectible* c = e->get<Collectible>();
-		serialize_s16(p, c->save_id);
-		serialize_enum(p, Resource, c->type);
-		serialize_s16(p, c->amount);
+		Stats* stats = &state_common.stats_window;
+		stats_add(&(Stream::IsWriting ? stats->entity_create_out : stats->entity_create_in)[s32(prefab)], stream_bits(p) - start_bits, stats_clock() - start_time);
 	}
 
 #if !SERVER
@@ -1635,8 +2028,12 @@ b8 equal_states_parkour(const StateFrame* frame_a, const StateFrame* frame_b, s3
 	return false;
 }
 
-template<typename Stream> b8 serialize_state_frame(Stream* p, StateFrame* frame, const StateFrame* base)
+// sections (optional) receives per-section bits and timing, indexed by StateFrameSection
+template<typename Stream> b8 serialize_state_frame(Stream* p, StateFrame* frame, const StateFrame* base, StatsEntry* sections = nullptr)
 {
+	s32 section_bits = stream_bits(p);
+	u64 section_time = sections ? stats_clock() : 0;
+
 	if (Stream::IsReading)
 	{
 		if (base)
@@ -1710,6 +2107,7 @@ template<typename Stream> b8 serialize_state_frame(Stream* p, StateFrame* frame,
 		vi_debug("Wrote %d transforms", changed_count);
 #endif
 	}
+	stats_state_frame_section(p, sections, StateFrameSection::Transforms, &section_bits, &section_time);
 
 	// players
 	for (s32 i = 0; i < MAX_PLAYERS; i++)
@@ -1726,6 +2124,8 @@ template<typename Stream> b8 serialize_state_frame(Stream* p, StateFrame* frame,
 		}
 	}
 
+	stats_state_frame_section(p, sections, StateFrameSection::Players, &section_bits, &section_time);
+
 	// walkers
 	{
 		s32 changed_count;
@@ -1770,6 +2170,8 @@ template<typename Stream> b8 serialize_state_frame(Stream* p, StateFrame* frame,
 		}
 	}
 
+	stats_state_frame_section(p, sections, StateFrameSection::Walkers, &section_bits, &section_time);
+
 	// drones
 	for (s32 i = 0; i < MAX_PLAYERS; i++)
 	{
@@ -1784,6 +2186,8 @@ template<typename Stream> b8 serialize_state_frame(Stream* p, StateFrame* frame,
 		}
 	}
 
+	stats_state_frame_section(p, sections, StateFrameSection::Drones, &section_bits, &section_time);
+
 	// parkours
 	for (s32 i = 0; i < MAX_PLAYERS; i++)
 	{
@@ -1798,13 +2202,25 @@ template<typename Stream> b8 serialize_state_frame(Stream* p, StateFrame* frame,
 		}
 	}
 
+	stats_state_frame_section(p, sections, StateFrameSection::Parkours, &section_bits, &section_time);
+
 	return true;
 }
 
-Resolution transform_resolution(const Transform* t)
+Resolution transform_resolution(const Transform* t, const StaticArray<Vec3, MAX_PLAYERS>& viewers, b8 shed)
 {
 	if (t->has<Drone>())
 		return Resolution::High;
+	if (shed)
+	{
+		Vec3 pos = t->absolute_pos();
+		for (s32 i = 0; i < viewers.length; i++)
+		{
+			if ((viewers[i] - pos).length_squared() < NET_DISTANT_RANGE * NET_DISTANT_RANGE)
+				return Resolution::Medium;
+		}
+		return Resolution::Low;
+	}
 	return Resolution::Medium;
 }
 
@@ -1812,6 +2228,18 @@ void state_frame_build(StateFrame* frame)
 {
 	frame->sequence_id = state_common.local_sequence_id;
 
+	b8 shed = Shed::active(Shed::Level::StateFrames);
+	StaticArray<Vec3, MAX_PLAYERS> viewers;
+	if (shed)
+	{
+		for (auto i = PlayerManager::list.iterator(); !i.is_last(); i.next())
+		{
+			Entity* instance = i.item()->instance.ref();
+			if (instance)
+				viewers.add(instance->get<Transform>()->absolute_pos());
+		}
+	}
+
 	// transforms
 	for (auto i = Transform::list.iterator(); !i.is_last(); i.next())
 	{
@@ -1823,7 +2251,7 @@ void state_frame_build(StateFrame* frame)
 			transform->pos = i.item()->pos;
 			transform->rot = i.item()->rot;
 			transform->parent = i.item()->parent.ref(); // ID must come out to IDNull if it's null; don't rely on revision to null the reference
-			transform->resolution = transform_resolution(i.item());
+			transform->resolution = transform_resolution(i.item(), viewers, shed);
 			if (i.item()->has<Target>())
 				transform->local_offset = i.item()->get<Target>()->local_offset;
 			else
@@ -2236,12 +2664,13 @@ struct Client
 		FlagLoadingDone = 1 << 1,
 		FlagIsAdmin = 1 << 2,
 		FlagIsVip = 1 << 3,
-		FlagLowLatencyInterpolation = 1 << 4,
+		FlagResumed = 1 << 4, // took over a parked session; its ClientSetup has to come from the same user
 	};
 
 	Sock::Address address;
 	r32 timeout;
 	r32 rtt = 0.5f;
+	r32 interpolation_delay; // as reported by the client; clamped before use
 	r32 auth_timeout = 8.0f; // we allow a client to connect for a certain amount of time before hearing from the master server that the client is okay
 	Master::UserKey user_key;
 	Ack ack = { u32(-1), NET_SEQUENCE_INVALID }; // most recent ack we've received from the client
@@ -2257,8 +2686,10 @@ struct Client
 	MessageFrameState processed_msg_frame = { NET_SEQUENCE_COUNT - 1, true };
 	SequenceID first_load_sequence;
 	SequenceID acked_state_frame = NET_SEQUENCE_INVALID; // most recent state frame the client has acked
+	u64 resume_token; // lets the client pick its players back up if the connection drops
 	char username[MAX_USERNAME + 1];
-	s8 flags = FlagLowLatencyInterpolation;
+	Stats stats; // messages and packets received from this client; state frames and packets sent to it
+	s8 flags;
 
 	b8 flag(Flags f) const
 	{
@@ -2291,12 +2722,24 @@ struct ExpectedClient
 	b8 is_vip;
 };
 
+// players of a client that timed out, kept in the game for a little while in case the client reconnects
+struct ResumeSession
+{
+	u64 token;
+	r32 timestamp;
+	Master::UserKey user_key;
+	StaticArray<Ref<PlayerHuman>, MAX_GAMEPADS> players;
+	char username[MAX_USERNAME + 1];
+	s8 flags;
+};
+
 b8 msg_process(StreamRead*, Client*, SequenceID);
 
 struct StateServer
 {
 	FILE* replay_file;
 	StaticArray<Client, MAX_PLAYERS> clients;
+	StaticArray<ResumeSession, MAX_PLAYERS> resume_sessions;
 	Array<Ref<Entity>> finalize_children_queue;
 	Array<ExpectedClient> expected_clients;
 	Mode mode;
@@ -2356,6 +2799,16 @@ ID client_id(const PlayerHuman* player)
 		return IDNull;
 }
 
+Client* client_for_address(const Sock::Address& address)
+{
+	for (s32 i = 0; i < state_server.clients.length; i++)
+	{
+		if (address.equals(state_server.clients[i].address))
+			return &state_server.clients[i];
+	}
+	return nullptr;
+}
+
 void packet_sent(const StreamWrite& p, const Sock::Address& address)
 {
 	if (state_server.replay_file && address.equals(state_server.replay_address))
@@ -2364,6 +2817,17 @@ void packet_sent(const StreamWrite& p, const Sock::Address& address)
 		fwrite(&size, sizeof(s16), 1, state_server.replay_file);
 		fwrite(p.data.data, sizeof(s8), s32(size), state_server.replay_file);
 	}
+
+	Client* client = client_for_address(address);
+	if (client)
+		stats_add(&client->stats.packets_out, p.bytes_written() * 8, 0);
+}
+
+void packet_received(s32 bits, const Sock::Address& address)
+{
+	Client* client = client_for_address(address);
+	if (client)
+		stats_add(&client->stats.packets_in, bits, 0);
 }
 
 void server_state(Master::ServerState* s)
@@ -2387,6 +2851,9 @@ void server_state(Master::ServerState* s)
 
 b8 master_send_status_update()
 {
+	if (Benchmark::active())
+		return true;
+
 	using Stream = StreamWrite;
 	StreamWrite p;
 	packet_init(&p);
@@ -2419,9 +2886,12 @@ void init()
 		vi_assert(false);
 	}
 
-	master_init();
-	master_send(Master::Message::Disconnect);
-	state_persistent.master.reset();
+	if (!Benchmark::active()) // benchmarks never advertise themselves to the master
+	{
+		master_init();
+		master_send(Master::Message::Disconnect);
+		state_persistent.master.reset();
+	}
 
 	if (Settings::public_ipv4[0])
 		Sock::Address::get(&state_server_persistent.public_ipv4, Settings::public_ipv4, Settings::port);
@@ -2497,6 +2967,7 @@ b8 packet_build_init(StreamWrite* p, Client* client)
 	ServerPacket type = ServerPacket::Init;
 	serialize_enum(p, ServerPacket, type);
 	serialize_int(p, SequenceID, client->first_load_sequence, 0, NET_SEQUENCE_COUNT - 1);
+	serialize_u64(p, client->resume_token);
 	if (!serialize_init_packet(p))
 		net_error();
 	packet_finalize(p);
@@ -2578,15 +3049,35 @@ b8 packet_build_update(StreamWrite* p, Client* client, StateFrame* frame)
 
 		serialize_int(p, SequenceID, client->acked_state_frame, 0, NET_SEQUENCE_COUNT); // not NET_SEQUENCE_COUNT - 1, because base_sequence_id might be NET_SEQUENCE_INVALID
 		const StateFrame* base = state_frame_by_sequence(state_common.state_history, client->acked_state_frame);
-		if (!serialize_state_frame(p, frame, base))
+		StatsEntry sections[s32(StateFrameSection::count)] = {};
+		if (!serialize_state_frame(p, frame, base, sections))
 			net_error();
+		stats_merge(state_common.stats_window.state_frame_out, sections, s32(StateFrameSection::count));
+		stats_merge(client->stats.state_frame_out, sections, s32(StateFrameSection::count));
 	}
 
 	packet_finalize(p);
 	return true;
 }
 
-void handle_client_disconnect(Client* c)
+void players_remove(const StaticArray<Ref<PlayerHuman>, MAX_GAMEPADS>& players)
+{
+	for (s32 i = 0; i < players.length; i++)
+	{
+		PlayerHuman* player = players[i].ref();
+		if (player)
+		{
+			Entity* instance = player->get<PlayerManager>()->instance.ref();
+			if (instance)
+				World::remove_deferred(instance);
+			World::remove_deferred(player->entity());
+		}
+	}
+}
+
+// resumable: the client dropped rather than leaving, so hold on to its players for NET_RESUME_WINDOW
+// only clients the master server has vouched for get parked; otherwise a resume would skip the auth wait
+void handle_client_disconnect(Client* c, b8 resumable = false)
 {
 	if (c->address.equals(state_server.replay_address))
 	{
@@ -2596,21 +3087,64 @@ void handle_client_disconnect(Client* c)
 		new (&state_server.replay_address) Sock::Address();
 	}
 
-	for (s32 i = 0; i < c->players.length; i++)
+	if (resumable
+		&& c->auth_timeout == 0.0f
+		&& c->players.length > 0
+		&& state_server.resume_sessions.length < state_server.resume_sessions.capacity())
 	{
-		PlayerHuman* player = c->players[i].ref();
-		if (player)
-		{
-			Entity* instance = player->get<PlayerManager>()->instance.ref();
-			if (instance)
-				World::remove_deferred(instance);
-			World::remove_deferred(player->entity());
-		}
+		ResumeSession* session = state_server.resume_sessions.add();
+		session->token = c->resume_token;
+		session->timestamp = state_common.timestamp;
+		session->user_key = c->user_key;
+		session->players = c->players;
+		memcpy(session->username, c->username, sizeof(session->username));
+		session->flags = c->flags & (Client::FlagIsAdmin | Client::FlagIsVip);
 	}
+	else
+		players_remove(c->players);
+
 	state_server.clients.remove(s32(c - &state_server.clients[0]));
 	master_send_status_update();
 }
 
+// the token is all a client needs to take over a session's players, so it comes from the OS rather than the gameplay RNG
+u64 resume_token_generate()
+{
+	std::random_device rd;
+	u64 token;
+	do
+		token = (u64(rd()) << 32) | u64(rd());
+	while (token == 0); // zero means the client has no token
+	return token;
+}
+
+ResumeSession* resume_session_find(u64 token)
+{
+	for (s32 i = 0; i < state_server.resume_sessions.length; i++)
+	{
+		if (state_server.resume_sessions[i].token == token)
+			return &state_server.resume_sessions[i];
+	}
+	return nullptr;
+}
+
+// hand a parked session's players to a newly connected client. the session was authenticated before it was parked,
+// and since the client has players, its ClientSetup message won't create new ones
+void resume_session_apply(Client* client, ResumeSession* session)
+{
+	client->auth_timeout = 0.0f;
+	client->flag(Client::FlagResumed, true);
+	client->user_key = session->user_key;
+	memcpy(client->username, session->username, sizeof(client->username));
+	client->flag(session->flags, true);
+	for (s32 i = 0; i < session->players.length; i++)
+	{
+		if (session->players[i].ref())
+			client->players.add(session->players[i]);
+	}
+	state_server.resume_sessions.remove(s32(session - &state_server.resume_sessions[0]));
+}
+
 void update(const Update& u, r32 dt)
 {
 	// prune ExpectedClients that have timed out
@@ -2624,6 +3158,20 @@ void update(const Update& u, r32 dt)
 		}
 	}
 
+	// give up on clients that didn't come back in time
+	for (s32 i = 0; i < state_server.resume_sessions.length; i++)
+	{
+		const ResumeSession& session = state_server.resume_sessions[i];
+		if (state_common.timestamp - session.timestamp > NET_RESUME_WINDOW)
+		{
+			vi_debug("Session for %s expired.", session.username);
+			players_remove(session.players);
+			state_server.resume_sessions.remove(i);
+			i--;
+			master_send_status_update();
+		}
+	}
+
 	for (s32 i = 0; i < state_server.clients.length; i++)
 	{
 		Client* client = &state_server.clients[i];
@@ -2632,9 +3180,15 @@ void update(const Update& u, r32 dt)
 			frame->read.rewind();
 			while (frame->read.bytes_read() < frame->bytes)
 			{
+				MessageType type;
+				s32 start_bits = frame->read.bits_read;
+				u64 start_time = stats_clock();
+				if (!msg_peek_type(&frame->read, &type))
+					break;
 				b8 success = msg_process(&frame->read, client, frame->sequence_id);
 				if (!success)
 					break;
+				stats_msg_in(type, frame->read.bits_read - start_bits, stats_clock() - start_time, &client->stats);
 			}
 		}
 
@@ -2678,7 +3232,7 @@ void tick(const Update& u, r32 dt)
 			sync_time();
 	}
 
-	if (PlayerHuman::list.count() == 0)
+	if (PlayerHuman::list.count() == 0 && !Benchmark::active())
 	{
 		if (state_server.mode != Mode::Idle)
 		{
@@ -2722,7 +3276,7 @@ void tick(const Update& u, r32 dt)
 				client->address.str(addr);
 				vi_debug("Client %s timed out.", addr);
 			}
-			handle_client_disconnect(client);
+			handle_client_disconnect(client, true);
 			i--;
 		}
 		else
@@ -2898,12 +3452,35 @@ b8 packet_handle(const Update& u, StreamRead* p, const Sock::Address& address)
 			serialize_s16(p, game_version);
 			s32 local_players;
 			serialize_int(p, s32, local_players, 1, MAX_GAMEPADS);
+			b8 resume;
+			serialize_bool(p, resume);
+			u64 resume_token = 0;
+			if (resume)
+				serialize_u64(p, resume_token);
 			if (game_version == GAME_VERSION)
 			{
 				if (state_server.mode == Mode::Active)
 				{
+					if (resume)
+					{
+						// the client noticed the drop before we did, maybe from a new address (NAT rebind, switching networks).
+						// park its old connection so it gets resumed below
+						for (s32 i = 0; i < state_server.clients.length; i++)
+						{
+							Client* old = &state_server.clients[i];
+							if (old->resume_token == resume_token && (!client || old == client))
+							{
+								handle_client_disconnect(old, true);
+								client = nullptr;
+								break;
+							}
+						}
+					}
+
+					ResumeSession* session = (!client && resume) ? resume_session_find(resume_token) : nullptr;
+
 					if (!client
-						&& Game::session.config.max_players >= PlayerHuman::list.count() + local_players
+						&& (session || Game::session.config.max_players >= PlayerHuman::list.count() + local_players)
 						&& state_server.clients.length < state_server.clients.capacity())
 					{
 						client = state_server.clients.add();
@@ -2911,10 +3488,19 @@ b8 packet_handle(const Update& u, StreamRead* p, const Sock::Address& address)
 						new (client) Client();
 						client->address = address;
 						client->first_load_sequence = state_common.local_sequence_id;
+						client->resume_token = resume_token_generate();
 						{
 							char str[NET_MAX_ADDRESS];
 							address.str(str);
 							vi_debug("Client %s starting on sequence %d", str, s32(client->first_load_sequence));
+							if (session)
+								vi_debug("Client %s resumed the session of %s.", str, session->username);
+						}
+
+						if (session)
+						{
+							resume_session_apply(client, session);
+							master_send_status_update();
 						}
 
 						if (Settings::record && Game::session.type != SessionType::Story && !state_server.replay_file)
@@ -3254,19 +3840,45 @@ b8 msg_process(StreamRead* p, Client* client, SequenceID seq)
 		}
 		case MessageType::ClientSetup:
 		{
-			// create players
-			if (client->players.length == 0)
-			{
-				serialize_u32(p, client->user_key.id);
-				serialize_u32(p, client->user_key.token);
+			Master::UserKey user_key;
+			serialize_u32(p, user_key.id);
+			serialize_u32(p, user_key.token);
 
-				s32 username_length;
-				serialize_int(p, s32, username_length, 0, MAX_USERNAME);
-				serialize_bytes(p, (u8*)client->username, username_length);
-				client->username[username_length] = '\0';
+			char username[MAX_USERNAME + 1];
+			s32 username_length;
+			serialize_int(p, s32, username_length, 0, MAX_USERNAME);
+			serialize_bytes(p, (u8*)username, username_length);
+			username[username_length] = '\0';
+
+			s32 local_players;
+			serialize_int(p, s32, local_players, 1, MAX_GAMEPADS);
+
+			if (client->flag(Client::FlagResumed) && !user_key.equals(client->user_key))
+			{
+				// somebody else has the resume token. park the session again for its owner
+				StreamWrite p;
+				packet_build_disconnect(&p, DisconnectReason::AuthFailed);
+				packet_send(p, client->address);
+				handle_client_disconnect(client, true);
+				return false;
+			}
 
-				s32 local_players;
-				serialize_int(p, s32, local_players, 1, MAX_GAMEPADS);
+			if (client->players.length > 0)
+			{
+				// resumed session; the players already exist, so skip the rest of the message
+				for (s32 i = 0; i < local_players; i++)
+				{
+					s8 gamepad;
+					serialize_int(p, s8, gamepad, 0, MAX_GAMEPADS - 1);
+					u64 uuid;
+					serialize_u64(p, uuid);
+				}
+			}
+			else
+			{
+				// create players
+				client->user_key = user_key;
+				memcpy(client->username, username, sizeof(client->username));
 
 				ExpectedClient::Teams teams;
 
@@ -3298,15 +3910,9 @@ b8 msg_process(StreamRead* p, Client* client, SequenceID seq)
 			}
 			break;
 		}
-		case MessageType::LowLatencyInterpolation:
+		case MessageType::InterpolationDelay:
 		{
-			b8 value;
-			serialize_bool(p, value);
-			client->flag(Client::FlagLowLatencyInterpolation, value);
-
-			char addr[NET_MAX_ADDRESS];
-			client->address.str(addr);
-			vi_debug("%s low-latency interpolation for client %s", value ? "Enabling" : "Disabling", addr);
+			serialize_r32_range(p, client->interpolation_delay, 0, 0.25f, 10);
 			break;
 		}
 		case MessageType::AddPlayer:
@@ -3456,14 +4062,21 @@ struct StateClient
 	enum Flags : s8
 	{
 		FlagReconnect = 1 << 0,
-		FlagLowLatencyInterpolation = 1 << 1,
 	};
 
 	FILE* replay_file;
 	r32 timeout;
 	r32 tick_timer;
-	r32 lag_score; // higher = less reliable network connection
 	r32 server_rtt = 0.15f;
+	// jitter buffer; all times are local arrival times
+	r32 frame_arrival_last;
+	r32 frame_jitter; // mean deviation of state frame inter-arrival time from the tick rate
+	r32 frame_loss; // smoothed fraction of state frames that never arrived
+	r32 interpolation_delay = 1.0f / 30.0f * INTERPOLATION_DELAY_MAX; // start conservative and converge downward
+	r32 interpolation_delay_sent = -1.0f; // most recent value reported to the server
+	r32 interpolation_delay_sync_timer;
+	SequenceID frame_sequence_last = NET_SEQUENCE_INVALID;
+	u64 resume_token; // from the server's Init packet; presented when reconnecting after a timeout
 	r32 rtts[MAX_PLAYERS];
 	u32 requested_server_id;
 	char requested_server_secret[MAX_SERVER_CONFIG_SECRET + 1];
@@ -3480,7 +4093,7 @@ struct StateClient
 	StoryModeTeam requested_story_mode_team;
 	Master::ClientConnectionStep connection_step;
 	s8 wait_slot_queue_position;
-	s8 flags = FlagLowLatencyInterpolation;
+	s8 flags;
 
 	b8 flag(Flags f) const
 	{
@@ -3692,6 +4305,10 @@ b8 packet_build_connect(StreamWrite* p)
 	serialize_s16(p, version);
 	s32 local_players = Game::session.local_player_count();;
 	serialize_int(p, s32, local_players, 1, MAX_GAMEPADS);
+	b8 resume = state_client.resume_token != 0;
+	serialize_bool(p, resume);
+	if (resume)
+		serialize_u64(p, state_client.resume_token);
 
 	packet_finalize(p);
 	return true;
@@ -3922,15 +4539,77 @@ void state_frame_apply(const StateFrame& frame, const StateFrame& frame_last, co
 	}
 }
 
-b8 send_low_latency_interpolation(b8 value)
+b8 send_interpolation_delay(r32 value)
 {
 	using Stream = StreamWrite;
-	StreamWrite* p = msg_new(MessageType::LowLatencyInterpolation);
-	serialize_bool(p, value);
+	StreamWrite* p = msg_new(MessageType::InterpolationDelay);
+	serialize_r32_range(p, value, 0, 0.25f, 10);
 	msg_finalize(p);
 	return true;
 }
 
+// called whenever a new state frame is inserted into the history
+void frame_arrived(SequenceID sequence_id)
+{
+	if (state_client.frame_sequence_last != NET_SEQUENCE_INVALID)
+	{
+		s32 gap = sequence_relative_to(sequence_id, state_client.frame_sequence_last);
+		if (gap > 0)
+		{
+			// RFC 3550-style running estimates
+			r32 interval = state_common.timestamp - state_client.frame_arrival_last;
+			r32 deviation = fabsf(interval - r32(gap) * tick_rate());
+			state_client.frame_jitter += (deviation - state_client.frame_jitter) * (1.0f / 16.0f);
+			state_client.frame_loss += (r32(gap - 1) / r32(gap) - state_client.frame_loss) * (1.0f / 16.0f);
+		}
+	}
+	state_client.frame_sequence_last = sequence_id;
+	state_client.frame_arrival_last = state_common.timestamp;
+}
+
+// smallest delay that keeps a frame on either side of the interpolated timestamp,
+// given the current jitter and loss estimates
+r32 interpolation_delay_target()
+{
+	switch (Settings::net_client_interpolation_mode)
+	{
+		case Settings::NetClientInterpolationMode::LowLatency:
+			return tick_rate() * INTERPOLATION_DELAY_MIN;
+		case Settings::NetClientInterpolationMode::Smooth:
+			return tick_rate() * INTERPOLATION_DELAY_MAX;
+		default:
+		{
+			r32 tick = tick_rate();
+			// one tick until the next frame is due, plus headroom for late frames
+			// and for covering a dropped frame once loss becomes noticeable
+			return interpolation_delay_clamp(tick * 1.25f + state_client.frame_jitter * 2.5f + tick * vi_min(1.0f, state_client.frame_loss * 10.0f));
+		}
+	}
+}
+
+void interpolation_delay_update(b8 underrun, r32 dt)
+{
+	r32 target = interpolation_delay_target();
+	r32 delay = state_client.interpolation_delay;
+	if (underrun && delay < target + tick_rate())
+		delay += dt * INTERPOLATION_SLEW_UNDERRUN; // we ran dry; back off immediately
+	else if (delay < target)
+		delay = vi_min(target, delay + dt * INTERPOLATION_SLEW);
+	else
+		delay = vi_max(target, delay - dt * INTERPOLATION_SLEW);
+	state_client.interpolation_delay = vi_min(delay, tick_rate() * INTERPOLATION_DELAY_MAX);
+
+	// the server uses our delay for lag compensation
+	state_client.interpolation_delay_sync_timer = vi_max(0.0f, state_client.interpolation_delay_sync_timer - dt);
+	if (state_client.interpolation_delay_sync_timer == 0.0f
+		&& fabsf(state_client.interpolation_delay - state_client.interpolation_delay_sent) > 0.002f)
+	{
+		send_interpolation_delay(state_client.interpolation_delay);
+		state_client.interpolation_delay_sent = state_client.interpolation_delay;
+		state_client.interpolation_delay_sync_timer = INTERPOLATION_SYNC_INTERVAL;
+	}
+}
+
 void update(const Update& u, r32 dt)
 {
 	if (master_auth_timer > 0.0f)
@@ -3949,7 +4628,18 @@ void update(const Update& u, r32 dt)
 		if (state_client.mode == Mode::Disconnected)
 			Console::debug("%s", "Disconnected");
 		else
-			Console::debug("%.0fkbps down | %.0fkbps up | %.0fms rtt | %.0fms interp | %.0f jitter", state_common.bandwidth_in * 8.0f / 500.0f, state_common.bandwidth_out * 8.0f / 500.0f, state_client.server_rtt * 1000.0f, interpolation_delay(nullptr) * 1000.0f, state_client.lag_score);
+		{
+			Console::debug("%.0fkbps down | %.0fkbps up | %.0fms rtt | %.0fms interp | %.1fms jitter | %.1f%% loss", state_common.bandwidth_in * 8.0f / 500.0f, state_common.bandwidth_out * 8.0f / 500.0f, state_client.server_rtt * 1000.0f, interpolation_delay(nullptr) * 1000.0f, state_client.frame_jitter * 1000.0f, state_client.frame_loss * 100.0f);
+
+			// breakdown of the last complete stats interval
+			char buffer[255];
+			stats_format_top(buffer, sizeof(buffer), state_common.stats_last.msgs_in, message_type_names, s32(MessageType::count), STATS_INTERVAL, 3);
+			Console::debug("in: %s", buffer);
+			stats_format_top(buffer, sizeof(buffer), state_common.stats_last.state_frame_in, state_frame_section_names, s32(StateFrameSection::count), STATS_INTERVAL, 3);
+			Console::debug("frames: %s", buffer);
+			stats_format_top(buffer, sizeof(buffer), state_common.stats_last.msgs_out, message_type_names, s32(MessageType::count), STATS_INTERVAL, 3);
+			Console::debug("out: %s", buffer);
+		}
 	}
 
 	if (state_client.mode == Mode::Disconnected)
@@ -3957,57 +4647,10 @@ void update(const Update& u, r32 dt)
 
 	if (state_client.mode == Mode::Connected)
 	{
-		// determine whether we can use low-latency interpolation
-		r32 interpolation_time = state_common.timestamp - internal_interpolation_delay(true);
-		const StateFrame* frame = state_frame_by_timestamp(state_common.state_history, interpolation_time);
+		// adapt interpolation delay; an underrun means we're holding the newest frame with nothing to interpolate toward
+		const StateFrame* frame = state_frame_by_timestamp(state_common.state_history, state_common.timestamp - state_client.interpolation_delay);
 		if (frame)
-		{
-			if (state_frame_next(state_common.state_history, *frame))
-				state_client.lag_score = vi_max(0.0f, state_client.lag_score - dt);
-			else
-				state_client.lag_score = vi_min(80.0f, state_client.lag_score + 4.0f * dt / tick_rate());
-
-			switch (Settings::net_client_interpolation_mode)
-			{
-				case Settings::NetClientInterpolationMode::Auto:
-				{
-					if (state_client.flag(StateClient::FlagLowLatencyInterpolation)
-						&& state_client.lag_score > 60.0f)
-					{
-						state_client.flag(StateClient::FlagLowLatencyInterpolation, false);
-						send_low_latency_interpolation(false);
-					}
-					else if (!state_client.flag(StateClient::FlagLowLatencyInterpolation)
-						&& state_client.lag_score < 20.0f)
-					{
-						state_client.flag(StateClient::FlagLowLatencyInterpolation, true);
-						send_low_latency_interpolation(true);
-					}
-					break;
-				}
-				case Settings::NetClientInterpolationMode::LowLatency:
-				{
-					if (!state_client.flag(StateClient::FlagLowLatencyInterpolation))
-					{
-						state_client.flag(StateClient::FlagLowLatencyInterpolation, true);
-						send_low_latency_interpolation(true);
-					}
-					break;
-				}
-				case Settings::NetClientInterpolationMode::Smooth:
-				{
-					if (state_client.flag(StateClient::FlagLowLatencyInterpolation))
-					{
-						state_client.flag(StateClient::FlagLowLatencyInterpolation, false);
-						send_low_latency_interpolation(false);
-					}
-					break;
-				}
-				default:
-					vi_assert(false);
-					break;
-			}
-		}
+			interpolation_delay_update(!state_frame_next(state_common.state_history, *frame), dt);
 	}
 
 	r32 interpolation_time = state_common.timestamp - interpolation_delay(nullptr);
@@ -4041,9 +4684,15 @@ void update(const Update& u, r32 dt)
 #endif
 		while (frame->read.bytes_read() < frame->bytes)
 		{
+			MessageType type;
+			s32 start_bits = frame->read.bits_read;
+			u64 start_time = stats_clock();
+			if (!msg_peek_type(&frame->read, &type))
+				break;
 			b8 success = Client::msg_process(&frame->read);
 			if (!success)
 				break;
+			stats_msg_in(type, frame->read.bits_read - start_bits, stats_clock() - start_time);
 		}
 	}
 }
@@ -4068,6 +4717,15 @@ void handle_server_disconnect(DisconnectReason reason)
 		Game::unload_level();
 		connect(addr);
 	}
+	else if (reason == DisconnectReason::Timeout && state_client.resume_token)
+	{
+		// the server holds on to our players for a while; try to get them back
+		Sock::Address addr = state_client.server_address;
+		u64 resume_token = state_client.resume_token;
+		Game::unload_level();
+		connect(addr);
+		state_client.resume_token = resume_token;
+	}
 	else
 	{
 		Game::unload_level();
@@ -4163,6 +4821,13 @@ void tick(const Update& u, r32 dt)
 			state_client.timeout += dt;
 			char str[NET_MAX_ADDRESS];
 			state_client.server_address.str(str);
+			if (state_client.resume_token && state_client.timeout > NET_RESUME_WINDOW)
+			{
+				vi_debug("Failed to resume session with %s.", str);
+				state_client.resume_token = 0;
+				handle_server_disconnect(DisconnectReason::Timeout);
+				break;
+			}
 			vi_debug("Connecting to %s...", str);
 			StreamWrite p;
 			packet_build_connect(&p);
@@ -4437,6 +5102,7 @@ b8 packet_handle(const Update& u, StreamRead* p, const Sock::Address& address)
 			{
 				SequenceID seq;
 				serialize_int(p, SequenceID, seq, 0, NET_SEQUENCE_COUNT - 1);
+				serialize_u64(p, state_client.resume_token);
 				if (!serialize_init_packet(p))
 					net_error();
 				state_client.server_processed_msg_frame = state_client.server_processed_load_msg_frame = { sequence_advance(seq, -1), true };
@@ -4502,7 +5168,7 @@ b8 packet_handle(const Update& u, StreamRead* p, const Sock::Address& address)
 				serialize_int(p, SequenceID, base_sequence_id, 0, NET_SEQUENCE_COUNT); // not NET_SEQUENCE_COUNT - 1, because base_sequence_id might be NET_SEQUENCE_INVALID
 				const StateFrame* base = state_frame_by_sequence(state_common.state_history, base_sequence_id);
 				StateFrame frame;
-				if (!serialize_state_frame(p, &frame, base))
+				if (!serialize_state_frame(p, &frame, base, state_common.stats_window.state_frame_in))
 					net_error();
 
 				// make sure the server says we have a base state frame if and only if we actually have it
@@ -4531,6 +5197,7 @@ b8 packet_handle(const Update& u, StreamRead* p, const Sock::Address& address)
 				if (state_common.state_history.frames.length == 0 || sequence_more_recent(frame.sequence_id, state_common.state_history.frames[state_common.state_history.current_index].sequence_id))
 				{
 					memcpy(state_frame_add(&state_common.state_history), &frame, sizeof(StateFrame));
+					frame_arrived(frame.sequence_id);
 
 					// let players know where the server thinks they are immediately, with no interpolation
 					for (auto i = PlayerControlHuman::list.iterator(); !i.is_last(); i.next())
@@ -4709,6 +5376,7 @@ b8 execute(const char* string)
 void init()
 {
 	Sock::init();
+	prefab_init();
 
 #if SERVER
 	Server::init();
@@ -4776,18 +5444,31 @@ b8 remove(Entity* e)
 
 #define NET_MAX_FRAME_TIME 0.2f
 
-struct PacketEntry
-{
-	r32 timestamp;
-	StreamRead packet;
-	Sock::Address address;
-	PacketEntry(r32 t) : timestamp(t), packet(), address() {}
-};
-
 #if DEBUG_LAG
-Array<PacketEntry> lag_buffer;
+Array<PacketEntry*> lag_buffer;
 #endif
 
+// receive buffers are recycled rather than constructed (and zeroed) for every packet
+PacketEntry* packet_entry_alloc(r32 timestamp)
+{
+	PacketEntry* entry;
+	if (state_persistent.packet_pool.length > 0)
+	{
+		entry = state_persistent.packet_pool[state_persistent.packet_pool.length - 1];
+		state_persistent.packet_pool.remove(state_persistent.packet_pool.length - 1);
+	}
+	else
+		entry = new PacketEntry();
+	entry->timestamp = timestamp;
+	entry->packet.reset();
+	return entry;
+}
+
+void packet_entry_free(PacketEntry* entry)
+{
+	state_persistent.packet_pool.add(entry);
+}
+
 void packet_read(const Update& u, PacketEntry* entry)
 {
 #if DEBUG_PACKET_LOSS
@@ -4796,20 +5477,175 @@ void packet_read(const Update& u, PacketEntry* entry)
 #endif
 
 	state_common.bandwidth_in_counter += entry->packet.bytes_total;
-
-	char buffer[512];
-	entry->address.str(buffer);
+	u64 start_time = stats_clock();
+	s32 bits = entry->packet.bytes_total * 8;
 
 	if (entry->packet.bytes_total > 0 && entry->packet.read_checksum())
 	{
-		packet_decompress(&entry->packet, entry->packet.bytes_total);
+		StreamRead* p = &state_persistent.packet_decoded;
+		packet_decompress(&entry->packet, p);
+#if SERVER
+		Server::packet_received(bits, entry->address);
+		Server::packet_handle(u, p, entry->address);
+#else
+		Client::packet_handle(u, p, entry->address);
+#endif
+	}
+
+	stats_add(&state_common.stats_window.packets_in, bits, stats_clock() - start_time);
+}
+
+void stats_update(r32 dt)
+{
+	state_common.stats_timer += dt;
+	if (state_common.stats_timer < STATS_INTERVAL)
+		return;
+
+	r32 interval = state_common.stats_timer;
+	stats_merge(&state_common.stats, state_common.stats_window);
+	stats_merge(&state_common.stats_log, state_common.stats_window);
+	state_common.stats_last = state_common.stats_window;
+	state_common.stats_window = Stats();
+	state_common.stats_timer = 0.0f;
+
+	state_common.stats_log_timer += interval;
 #if SERVER
-		Server::packet_handle(u, &entry->packet, entry->address);
+	b8 log = state_common.stats_log_timer >= STATS_LOG_INTERVAL;
 #else
-		Client::packet_handle(u, &entry->packet, entry->address);
+	b8 log = show_stats;
+#endif
+	if (log && state_common.stats_log.packets_out.count > 0)
+		stats_log(state_common.stats_log, state_common.stats_log_timer);
+	if (log || state_common.stats_log_timer >= STATS_LOG_INTERVAL)
+	{
+		state_common.stats_log = Stats();
+		state_common.stats_log_timer = 0.0f;
+	}
+}
+
+cJSON* stats_json_entry(const StatsEntry& e)
+{
+	cJSON* json = cJSON_CreateObject();
+	cJSON_AddNumberToObject(json, "bytes", r64(e.bits) / 8.0);
+	cJSON_AddNumberToObject(json, "count", r64(e.count));
+	cJSON_AddNumberToObject(json, "ns", r64(e.ns));
+	return json;
+}
+
+cJSON* stats_json_entries(const StatsEntry* entries, const char** names, s32 count)
+{
+	cJSON* json = cJSON_CreateObject();
+	for (s32 i = 0; i < count; i++)
+	{
+		if (entries[i].count > 0)
+			cJSON_AddItemToObject(json, names[i], stats_json_entry(entries[i]));
+	}
+	return json;
+}
+
+void stats_json(cJSON* json, const Stats& stats)
+{
+	cJSON_AddItemToObject(json, "msgs_out", stats_json_entries(stats.msgs_out, message_type_names, s32(MessageType::count)));
+	cJSON_AddItemToObject(json, "msgs_in", stats_json_entries(stats.msgs_in, message_type_names, s32(MessageType::count)));
+	cJSON_AddItemToObject(json, "state_frame_out", stats_json_entries(stats.state_frame_out, state_frame_section_names, s32(StateFrameSection::count)));
+	cJSON_AddItemToObject(json, "state_frame_in", stats_json_entries(stats.state_frame_in, state_frame_section_names, s32(StateFrameSection::count)));
+	cJSON_AddItemToObject(json, "entity_create_out", stats_json_entries(stats.entity_create_out, prefab_names, s32(Prefab::count)));
+	cJSON_AddItemToObject(json, "entity_create_in", stats_json_entries(stats.entity_create_in, prefab_names, s32(Prefab::count)));
+	cJSON_AddItemToObject(json, "packets_out", stats_json_entry(stats.packets_out));
+	cJSON_AddItemToObject(json, "packets_in", stats_json_entry(stats.packets_in));
+}
+
+// dump everything recorded since the level was loaded
+void stats_dump(const char* filename)
+{
+	Stats stats = state_common.stats;
+	stats_merge(&stats, state_common.stats_window);
+
+	cJSON* json = cJSON_CreateObject();
+	cJSON_AddNumberToObject(json, "level", Game::level.id);
+	cJSON_AddNumberToObject(json, "time", state_common.timestamp);
+	stats_json(json, stats);
+
+#if SERVER
+	cJSON* clients = cJSON_CreateArray();
+	for (s32 i = 0; i < Server::state_server.clients.length; i++)
+	{
+		const Server::Client& client = Server::state_server.clients[i];
+		cJSON* client_json = cJSON_CreateObject();
+		char addr[NET_MAX_ADDRESS];
+		client.address.str(addr);
+		cJSON_AddStringToObject(client_json, "address", addr);
+		cJSON_AddStringToObject(client_json, "username", client.username);
+		cJSON_AddNumberToObject(client_json, "rtt", client.rtt);
+		stats_json(client_json, client.stats);
+		cJSON_AddItemToArray(clients, client_json);
+	}
+	cJSON_AddItemToObject(json, "clients", clients);
 #endif
+
+	char path[MAX_PATH_LENGTH + 1];
+	Loader::user_data_path(path, filename);
+	FILE* f = fopen(path, "wb");
+	if (f)
+	{
+		char* data = cJSON_Print(json);
+		fprintf(f, "%s", data);
+		fclose(f);
+		free(data);
+		vi_debug("Wrote net stats to %s", path);
+	}
+	else
+		vi_debug("Can't open file '%s'", path);
+	cJSON_Delete(json);
+}
+
+#if SERVER
+// labeled by address rather than username, since usernames would need escaping
+void metrics_client_labels(const Server::Client& client, char* labels)
+{
+	char addr[NET_MAX_ADDRESS];
+	client.address.str(addr);
+	sprintf(labels, "client=\"%s\"", addr);
+}
+
+void metrics(Metrics::Writer* w)
+{
+	Stats stats = state_common.stats;
+	stats_merge(&stats, state_common.stats_window);
+
+	w->header("deceiver_sent_bytes_total", "counter", "Bytes sent since the level was loaded.");
+	w->value("deceiver_sent_bytes_total", r64(stats.packets_out.bits / 8));
+	w->header("deceiver_received_bytes_total", "counter", "Bytes received since the level was loaded.");
+	w->value("deceiver_received_bytes_total", r64(stats.packets_in.bits / 8));
+
+	const StaticArray<Server::Client, MAX_PLAYERS>& clients = Server::state_server.clients;
+	char labels[NET_MAX_ADDRESS + 16];
+
+	w->header("deceiver_clients", "gauge", "Connected clients.");
+	w->value("deceiver_clients", r64(clients.length));
+
+	w->header("deceiver_client_rtt_seconds", "gauge", "Smoothed round trip time per client.");
+	for (s32 i = 0; i < clients.length; i++)
+	{
+		metrics_client_labels(clients[i], labels);
+		w->value("deceiver_client_rtt_seconds", r64(clients[i].rtt), labels);
+	}
+
+	w->header("deceiver_client_sent_bytes_total", "counter", "Bytes sent per client since they connected.");
+	for (s32 i = 0; i < clients.length; i++)
+	{
+		metrics_client_labels(clients[i], labels);
+		w->value("deceiver_client_sent_bytes_total", r64(clients[i].stats.packets_out.bits / 8), labels);
+	}
+
+	w->header("deceiver_client_received_bytes_total", "counter", "Bytes received per client since they connected.");
+	for (s32 i = 0; i < clients.length; i++)
+	{
+		metrics_client_labels(clients[i], labels);
+		w->value("deceiver_client_received_bytes_total", r64(clients[i].stats.packets_in.bits / 8), labels);
 	}
 }
+#endif
 
 void update_start(const Update& u)
 {
@@ -4829,14 +5665,15 @@ void update_start(const Update& u)
 				s32 bytes_received = s32(size);
 				if (bytes_received > 0)
 				{
-					PacketEntry entry(state_common.timestamp);
-					entry.address = Client::state_client.server_address;
-					if (fread(entry.packet.data.data, sizeof(s8), bytes_received, Client::state_client.replay_file) == bytes_received)
+					PacketEntry* entry = packet_entry_alloc(state_common.timestamp);
+					entry->address = Client::state_client.server_address;
+					if (fread(entry->packet.data.data, sizeof(s8), bytes_received, Client::state_client.replay_file) == bytes_received)
 					{
-						entry.packet.resize_bytes(bytes_received);
-						packet_read(u, &entry);
+						entry->packet.resize_bytes(bytes_received);
+						packet_read(u, entry);
 						packet_successfully_read = true;
 					}
+					packet_entry_free(entry);
 				}
 			}
 
@@ -4849,40 +5686,48 @@ void update_start(const Update& u)
 
 	while (true)
 	{
-		PacketEntry entry(state_common.timestamp);
-		s32 bytes_received = Sock::udp_receive(&state_persistent.sock, &entry.address, entry.packet.data.data, NET_MAX_PACKET_SIZE);
-		entry.packet.resize_bytes(bytes_received);
+		PacketEntry* entry = packet_entry_alloc(state_common.timestamp);
+		s32 bytes_received = Sock::udp_receive(&state_persistent.sock, &entry->address, entry->packet.data.data, NET_MAX_PACKET_SIZE);
 		if (bytes_received > 0)
 		{
+			entry->packet.resize_bytes(bytes_received);
 #if DEBUG_LAG
 			lag_buffer.add(entry); // save for later
 #else
 #if !SERVER
 			if (Client::state_client.replay_mode == Client::ReplayMode::Replaying)
+			{
+				packet_entry_free(entry);
 				continue; // ignore all incoming packets while we're replaying
+			}
 			else if (Client::state_client.replay_mode == Client::ReplayMode::Recording
-				&& entry.address.equals(Client::state_client.server_address))
+				&& entry->address.equals(Client::state_client.server_address))
 			{
 				s16 size = s16(bytes_received);
 				fwrite(&size, sizeof(s16), 1, Client::state_client.replay_file);
-				fwrite(entry.packet.data.data, sizeof(s8), bytes_received, Client::state_client.replay_file);
+				fwrite(entry->packet.data.data, sizeof(s8), bytes_received, Client::state_client.replay_file);
 			}
 #endif
-			packet_read(u, &entry); // read packet instantly
+			packet_read(u, entry); // read packet instantly
+			packet_entry_free(entry);
 #endif
 		}
 		else
+		{
+			packet_entry_free(entry);
 			break;
+		}
 	}
 
 #if DEBUG_LAG
 	// wait DEBUG_LAG_AMOUNT before reading packet
 	for (s32 i = 0; i < lag_buffer.length; i++)
 	{
-		PacketEntry* entry = &lag_buffer[i];
+		PacketEntry* entry = lag_buffer[i];
 		if (entry->timestamp < state_common.timestamp - DEBUG_LAG_AMOUNT / Game::session.effective_time_scale())
 		{
 			packet_read(u, entry);
+			packet_entry_free(entry);
 			lag_buffer.remove_ordered(i);
 			i--;
 		}
@@ -4903,11 +5748,14 @@ void update_start(const Update& u)
 		state_common.bandwidth_in_counter = 0;
 		state_common.bandwidth_out_counter = 0;
 	}
+
+	stats_update(dt);
 }
 
 void update_end(const Update& u)
 {
 	r32 dt = vi_min(Game::real_time.delta, NET_MAX_FRAME_TIME);
+	state_common.msgs_encoding.length = 0; // messages never live across frames
 #if SERVER
 	// server always runs at 60 FPS
 	Server::tick(u, dt);
@@ -4948,7 +5796,7 @@ void reset()
 
 #if DEBUG_LAG
 	for (s32 i = 0; i < lag_buffer.length; i++)
-		lag_buffer[i].timestamp = 0.0f; // make sure these packets get consumed
+		lag_buffer[i]->timestamp = 0.0f; // make sure these packets get consumed
 #endif
 
 	state_common.~StateCommon();
@@ -4976,6 +5824,8 @@ StreamWrite* msg_new(MessageBuffer* buffer, MessageType t)
 {
 	StreamWrite* result = buffer->add();
 	result->reset();
+	if (state_common.msgs_encoding.length < state_common.msgs_encoding.capacity())
+		state_common.msgs_encoding.add({ result, stats_clock() });
 	msg_serialize_type(result, t);
 	return result;
 }
@@ -5153,9 +6003,22 @@ b8 msg_finalize(StreamWrite* p)
 	r.rewind();
 	MessageType type;
 	serialize_enum(&r, MessageType, type);
+
+	// messages are normally finalized in the order they were created, but search the whole stack
+	// in case one was abandoned; anything created after this one is stale
+	for (s32 i = state_common.msgs_encoding.length - 1; i >= 0; i--)
+	{
+		if (state_common.msgs_encoding[i].msg == p)
+		{
+			stats_add(&state_common.stats_window.msgs_out[s32(type)], p->bits_written(), stats_clock() - state_common.msgs_encoding[i].start);
+			state_common.msgs_encoding.length = i;
+			break;
+		}
+	}
+
 	if (type != MessageType::Noop
 		&& type != MessageType::ClientSetup
-		&& type != MessageType::LowLatencyInterpolation
+		&& type != MessageType::InterpolationDelay
 		&& type != MessageType::EntityCreate
 		&& type != MessageType::EntityRemove
 		&& type != MessageType::InitDone
@@ -5218,18 +6081,13 @@ r32 tick_rate()
 
 r32 interpolation_delay(const PlayerHuman* ph)
 {
-	b8 low_latency;
 #if SERVER
 	Server::Client* client = Server::client_for_player(ph);
-	if (client)
-		low_latency = client->flag(Server::Client::FlagLowLatencyInterpolation);
-	else
-		low_latency = false;
+	return interpolation_delay_clamp(client ? client->interpolation_delay : 0.0f);
 #else
 	vi_assert(!ph || ph->local());
-	low_latency = Client::state_client.flag(Client::StateClient::FlagLowLatencyInterpolation);
+	return Client::state_client.interpolation_delay;
 #endif
-	return internal_interpolation_delay(low_latency);
 }
 
 
@@ -21,6 +21,13 @@ namespace Sock
 	struct Address;
 }
 
+#if SERVER
+namespace Metrics
+{
+	struct Writer;
+}
+#endif
+
 namespace Net
 {
 
@@ -52,7 +59,7 @@ enum class MessageType : s8
 	TransitionLevel,
 	AddPlayer,
 	DebugCommand,
-	LowLatencyInterpolation,
+	InterpolationDelay,
 	count,
 };
 
@@ -121,6 +128,10 @@ void finalize(Entity*);
 void finalize_child(Entity*);
 b8 remove(Entity*);
 extern b8 show_stats;
+void stats_dump(const char*);
+#if SERVER
+void metrics(Metrics::Writer*);
+#endif
 
 enum class DisconnectReason : s8
 {
@@ -0,0 +1,369 @@
+#pragma once
+
+#include "net_serialize.h"
+#include "data/entity.h"
+
+namespace VI
+{
+
+namespace Net
+{
+
+// compile-time network schemas for replicated components.
+// a schema is a FieldList of descriptors, each pointing at one member.
+// the templates below generate read/write and field-level delta routines with no per-field branching.
+// every descriptor uses exactly the same encoding as the equivalent serialize_* macro, so schemas are wire-compatible
+// with hand-written serializers.
+namespace Schema
+{
+
+// plain integers and bools written with serialize_bits
+template<typename C, typename T> struct Bits
+{
+	T C::*member;
+	s32 count;
+
+	constexpr Bits(T C::*m, s32 c) : member(m), count(c) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		T& value = c->*member;
+		serialize_bits(p, T, value, count);
+		return true;
+	}
+};
+
+template<typename C> struct U64
+{
+	u64 C::*member;
+
+	constexpr U64(u64 C::*m) : member(m) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		u64& value = c->*member;
+		serialize_u64(p, value);
+		return true;
+	}
+};
+
+// integers or enums within an explicit range
+template<typename C, typename T> struct Int
+{
+	T C::*member;
+	s32 range_min;
+	s32 range_max;
+
+	constexpr Int(T C::*m, s32 _min, s32 _max) : member(m), range_min(_min), range_max(_max) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		T& value = c->*member;
+		serialize_int(p, T, value, range_min, range_max);
+		return true;
+	}
+};
+
+template<typename C, typename T> struct Enum
+{
+	T C::*member;
+
+	constexpr Enum(T C::*m) : member(m) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		T& value = c->*member;
+		serialize_enum(p, T, value);
+		return true;
+	}
+};
+
+template<typename C> struct R32
+{
+	r32 C::*member;
+
+	constexpr R32(r32 C::*m) : member(m) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		r32& value = c->*member;
+		serialize_r32(p, value);
+		return true;
+	}
+};
+
+template<typename C> struct R32Range
+{
+	r32 C::*member;
+	r32 range_min;
+	r32 range_max;
+	s32 count;
+
+	constexpr R32Range(r32 C::*m, r32 _min, r32 _max, s32 c) : member(m), range_min(_min), range_max(_max), count(c) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		r32& value = c->*member;
+		serialize_r32_range(p, value, range_min, range_max, count);
+		return true;
+	}
+};
+
+// Vec2/Vec3 members written component by component, all with the same quantization
+template<typename C, typename V, s32 n> struct VecRange
+{
+	V C::*member;
+	r32 range_min;
+	r32 range_max;
+	s32 count;
+
+	constexpr VecRange(V C::*m, r32 _min, r32 _max, s32 c) : member(m), range_min(_min), range_max(_max), count(c) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		V& v = c->*member;
+		for (s32 i = 0; i < n; i++)
+			serialize_r32_range(p, v[i], range_min, range_max, count);
+		return true;
+	}
+};
+
+template<typename C, typename V, s32 n> struct Vec
+{
+	V C::*member;
+
+	constexpr Vec(V C::*m) : member(m) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		V& v = c->*member;
+		for (s32 i = 0; i < n; i++)
+			serialize_r32(p, v[i]);
+		return true;
+	}
+};
+
+template<typename C, typename T> struct RefField
+{
+	Ref<T> C::*member;
+
+	constexpr RefField(Ref<T> C::*m) : member(m) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return (a.*member).equals(b.*member);
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		Ref<T>& value = c->*member;
+		serialize_ref(p, value);
+		return true;
+	}
+};
+
+// asset counts are only known at runtime, so point at them
+template<typename C> struct Asset
+{
+	AssetID C::*member;
+	const s32* asset_count;
+
+	constexpr Asset(AssetID C::*m, const s32* c) : member(m), asset_count(c) {}
+
+	b8 equal(const C& a, const C& b) const
+	{
+		return a.*member == b.*member;
+	}
+
+	void copy(C* a, const C& b) const
+	{
+		a->*member = b.*member;
+	}
+
+	template<typename Stream> b8 serialize(Stream* p, C* c) const
+	{
+		AssetID& value = c->*member;
+		serialize_asset(p, value, *asset_count);
+		return true;
+	}
+};
+
+template<typename C, typename T> constexpr Bits<C, T> field_bool(T C::*m) { return Bits<C, T>(m, 1); }
+template<typename C, typename T> constexpr Bits<C, T> field_s8(T C::*m) { return Bits<C, T>(m, 8); }
+template<typename C, typename T> constexpr Bits<C, T> field_s16(T C::*m) { return Bits<C, T>(m, 16); }
+template<typename C, typename T> constexpr Bits<C, T> field_s32(T C::*m) { return Bits<C, T>(m, 32); }
+template<typename C, typename T> constexpr Bits<C, T> field_u32(T C::*m) { return Bits<C, T>(m, 32); }
+template<typename C> constexpr U64<C> field_u64(u64 C::*m) { return U64<C>(m); }
+template<typename C, typename T> constexpr Int<C, T> field_int(T C::*m, s32 min, s32 max) { return Int<C, T>(m, min, max); }
+template<typename C, typename T> constexpr Enum<C, T> field_enum(T C::*m) { return Enum<C, T>(m); }
+template<typename C> constexpr R32<C> field_r32(r32 C::*m) { return R32<C>(m); }
+template<typename C> constexpr R32Range<C> field_r32_range(r32 C::*m, r32 min, r32 max, s32 bits) { return R32Range<C>(m, min, max, bits); }
+template<typename C> constexpr VecRange<C, Vec2, 2> field_vec2_range(Vec2 C::*m, r32 min, r32 max, s32 bits) { return VecRange<C, Vec2, 2>(m, min, max, bits); }
+template<typename C> constexpr VecRange<C, Vec3, 3> field_vec3_range(Vec3 C::*m, r32 min, r32 max, s32 bits) { return VecRange<C, Vec3, 3>(m, min, max, bits); }
+template<typename C> constexpr Vec<C, Vec3, 3> field_vec3(Vec3 C::*m) { return Vec<C, Vec3, 3>(m); }
+template<typename C, typename T> constexpr RefField<C, T> field_ref(Ref<T> C::*m) { return RefField<C, T>(m); }
+template<typename C> constexpr Asset<C> field_asset(AssetID C::*m, const s32* count) { return Asset<C>(m, count); }
+
+template<typename... Fields> struct FieldList;
+
+template<> struct FieldList<>
+{
+	constexpr FieldList() {}
+};
+
+template<typename F, typename... Rest> struct FieldList<F, Rest...>
+{
+	F head;
+	FieldList<Rest...> tail;
+
+	constexpr FieldList(F h, Rest... r) : head(h), tail(r...) {}
+};
+
+template<typename... Fields> constexpr FieldList<Fields...> fields(Fields... f)
+{
+	return FieldList<Fields...>(f...);
+}
+
+// read or write every field in declaration order
+
+template<typename Stream, typename C> b8 serialize(Stream*, C*, const FieldList<>&)
+{
+	return true;
+}
+
+template<typename Stream, typename C, typename F, typename... Rest> b8 serialize(Stream* p, C* c, const FieldList<F, Rest...>& f)
+{
+	if (!f.head.serialize(p, c))
+		net_error();
+	return serialize(p, c, f.tail);
+}
+
+// one bit per field, followed by the field only if it differs from the base.
+// with no base, every field is written.
+template<typename Stream, typename C> b8 serialize_delta(Stream*, C*, const C*, const FieldList<>&)
+{
+	return true;
+}
+
+template<typename Stream, typename C, typename F, typename... Rest> b8 serialize_delta(Stream* p, C* c, const C* base, const FieldList<F, Rest...>& f)
+{
+	b8 changed;
+	if (Stream::IsWriting)
+		changed = !base || !f.head.equal(*c, *base);
+	serialize_bool(p, changed);
+	if (changed)
+	{
+		if (!f.head.serialize(p, c))
+			net_error();
+	}
+	else if (Stream::IsReading)
+	{
+		if (!base)
+			net_error();
+		f.head.copy(c, *base);
+	}
+	return serialize_delta(p, c, base, f.tail);
+}
+
+}
+
+// specialized once per replicated component with NET_SCHEMA
+template<typename T> struct NetSchema;
+
+#define NET_SCHEMA(T, ...)\
+template<> struct NetSchema<T>\
+{\
+	static constexpr decltype(Schema::fields(__VA_ARGS__)) fields()\
+	{\
+		return Schema::fields(__VA_ARGS__);\
+	}\
+}
+
+}
+
+}
@@ -307,6 +307,8 @@ void StreamRead::resize_bytes(s32 b)
 {
 	data.resize((b / sizeof(u32)) + (b % sizeof(u32) == 0 ? 0 : 1));
 	bytes_total = b;
+	// receive buffers get reused, and the CRC32 covers whole words, so zero the rest of the last word
+	memset(((u8*)data.data) + b, 0, data.length * sizeof(u32) - b);
 }
 
 b8 StreamRead::align()
@@ -371,18 +373,18 @@ void packet_finalize(StreamWrite* p)
 	p->data[0] = checksum;
 }
 
-void packet_decompress(StreamRead* p, s32 bytes)
+// inflates a received packet straight into the stream that will be parsed
+void packet_decompress(const StreamRead* in, StreamRead* out)
 {
-	StreamRead decompressed;
-	decompressed.resize_bytes(NET_MAX_PACKET_SIZE);
-	
+	out->reset();
+
 	z_stream z;
 	z.zalloc = nullptr;
 	z.zfree = nullptr;
 	z.opaque = nullptr;
-	z.next_in = (Bytef*)&p->data[1];
-	z.avail_in = bytes - sizeof(u32);
-	z.next_out = (Bytef*)&decompressed.data[1];
+	z.next_in = (Bytef*)&in->data[1];
+	z.avail_in = in->bytes_total - sizeof(u32);
+	z.next_out = (Bytef*)&out->data.data[1];
 	z.avail_out = NET_MAX_PACKET_SIZE - sizeof(u32);
 
 	s32 result = inflateInit(&z);
@@ -394,14 +396,12 @@ void packet_decompress(StreamRead* p, s32 bytes)
 	result = inflateEnd(&z);
 	vi_assert(result == Z_OK);
 
-	p->reset();
-	p->resize_bytes(sizeof(u32) + (NET_MAX_PACKET_SIZE - sizeof(u32)) - z.avail_out);
-	vi_assert(p->data.length > 0);
-
-	p->data[p->data.length - 1] = 0;
-	memcpy(&p->data[1], &decompressed.data[1], NET_MAX_PACKET_SIZE - z.avail_out);
+	s32 bytes = sizeof(u32) + (NET_MAX_PACKET_SIZE - sizeof(u32)) - z.avail_out;
+	out->resize_bytes(bytes);
+	vi_assert(out->data.length > 0);
 
-	p->bits_read = 32; // skip past the CRC32
+	out->data[0] = in->data[0]; // CRC32
+	out->bits_read = 32; // skip past the CRC32
 }
 
 // true if s1 > s2
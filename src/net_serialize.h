@@ -72,7 +72,7 @@ typedef u16 SequenceID;
 
 void packet_init(StreamWrite*);
 void packet_finalize(StreamWrite*);
-void packet_decompress(StreamRead*, s32);
+void packet_decompress(const StreamRead*, StreamRead*);
 
 // true if s1 > s2
 b8 sequence_more_recent(SequenceID, SequenceID);
@@ -1,32 +1,145 @@
 #include "physics.h"
 #include "data/components.h"
 #include "load.h"
+#include "jobs.h"
+#include "static_world.h"
 #include "bullet/src/BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+#include "bullet/src/BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "bullet/src/BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h"
+#include "bullet/src/LinearMath/btThreads.h"
 #include "game/game.h"
 #include "game/entities.h"
 #include "game/player.h"
+#include "platform/util.h"
+#include <stdio.h>
+#include <unordered_map>
 
 namespace VI
 {
 
-btDbvtBroadphase* Physics::broadphase = new btDbvtBroadphase();
-btDefaultCollisionConfiguration* Physics::collision_config = new btDefaultCollisionConfiguration();
-btCollisionDispatcher* Physics::dispatcher = new btCollisionDispatcher(Physics::collision_config);
-btSequentialImpulseConstraintSolver* Physics::solver = new btSequentialImpulseConstraintSolver;
-btDiscreteDynamicsWorld* Physics::btWorld = new btDiscreteDynamicsWorld(dispatcher, broadphase, solver, collision_config);
+btDbvtBroadphase* Physics::broadphase;
+btDefaultCollisionConfiguration* Physics::collision_config;
+btCollisionDispatcher* Physics::dispatcher;
+btSequentialImpulseConstraintSolver* Physics::solver;
+btDiscreteDynamicsWorld* Physics::btWorld;
+PhysicsStep Physics::step;
+PhysicsStats Physics::stats;
+b8 Physics::multithreaded;
+b8 Physics::raycast_batch_per_ray;
+
+struct PhysicsParallelFor
+{
+	const btIParallelForBody* body;
+	s32 start;
+};
+
+void physics_parallel_for(s32 start, s32 end, void* data)
+{
+	const PhysicsParallelFor* p = (const PhysicsParallelFor*)data;
+	p->body->forLoop(p->start + start, p->start + end);
+}
+
+// runs Bullet's parallel loops on our job pool
+class PhysicsTaskScheduler : public btITaskScheduler
+{
+public:
+	PhysicsTaskScheduler()
+		: btITaskScheduler("Jobs")
+	{
+	}
+
+	// Bullet hands out thread indices to every thread that touches it (main, physics, job workers), in whatever order
+	// they show up, and uses them to index arrays sized by these. so size them for any index it can hand out
+	virtual int getMaxNumThreads() const
+	{
+		return BT_MAX_THREAD_COUNT;
+	}
+
+	virtual int getNumThreads() const
+	{
+		return BT_MAX_THREAD_COUNT;
+	}
+
+	virtual void setNumThreads(int)
+	{
+		// the pool is sized once at startup
+	}
+
+	virtual void parallelFor(int start, int end, int grain, const btIParallelForBody& body)
+	{
+		PhysicsParallelFor p = { &body, start };
+		Jobs::parallel_for(end - start, grain, &physics_parallel_for, &p);
+	}
+
+	virtual btScalar parallelSum(int start, int end, int, const btIParallelSumBody& body)
+	{
+		return body.sumLoop(start, end); // only the Mt solver uses this, and we pool the regular solver instead
+	}
+};
+PhysicsTaskScheduler physics_task_scheduler;
+
+void Physics::init(b8 mt)
+{
+	multithreaded = mt;
+	broadphase = new btDbvtBroadphase();
+	collision_config = new btDefaultCollisionConfiguration();
+	solver = new btSequentialImpulseConstraintSolver;
+	if (multithreaded)
+	{
+		btSetTaskScheduler(&physics_task_scheduler);
+		dispatcher = new btCollisionDispatcherMt(collision_config);
+		btConstraintSolverPoolMt* solver_pool = new btConstraintSolverPoolMt(Jobs::workers() + 1); // solvers are claimed by locking, not by thread index. the calling thread works too
+		btWorld = new btDiscreteDynamicsWorldMt(dispatcher, broadphase, solver_pool, solver, collision_config);
+	}
+	else
+	{
+		dispatcher = new btCollisionDispatcher(collision_config);
+		btWorld = new btDiscreteDynamicsWorld(dispatcher, broadphase, solver, collision_config);
+	}
+	vi_debug("Physics: %s.", multithreaded ? "multithreaded" : "single-threaded");
+}
 
 void Physics::loop(PhysicsSwapper* swapper)
 {
 	PhysicsSync* data = swapper->swap<SwapType::Read>();
 	while (!data->quit)
 	{
-		btWorld->stepSimulation(vi_min(data->time.delta, 0.1f), 3, data->timestep);
+		r64 start = platform::time();
+		s32 substeps = btWorld->stepSimulation(vi_min(data->time.delta, 0.1f), 3, data->timestep);
+		r32 time = r32(platform::time() - start);
+
+		s32 bodies_active = 0;
+		const btCollisionObjectArray& objects = btWorld->getCollisionObjectArray();
+		for (s32 i = 0; i < objects.size(); i++)
+		{
+			if (objects[i]->isActive() && !objects[i]->isStaticOrKinematicObject())
+				bodies_active++;
+		}
+
+		s32 manifolds = dispatcher->getNumManifolds();
+		s32 contacts = 0;
+		for (s32 i = 0; i < manifolds; i++)
+			contacts += dispatcher->getManifoldByIndexInternal(i)->getNumContacts();
+
+		step.time = time;
+		step.substeps = substeps;
+		step.bodies_active = bodies_active;
+		step.manifolds = manifolds;
+		step.contacts = contacts;
+		step.id++;
+
 		data = swapper->swap<SwapType::Read>();
 	}
 }
 
+u64 microseconds(r64 seconds)
+{
+	return u64(vi_max(0.0, seconds) * 1000000.0);
+}
+
 void Physics::sync_static()
 {
+	r64 start = platform::time();
 	for (auto i = RigidBody::list.iterator(); !i.is_last(); i.next())
 	{
 #if SERVER
@@ -38,15 +151,34 @@ void Physics::sync_static()
 			{
 				btTransform transform;
 				i.item()->get<Transform>()->get_bullet(transform);
+				if (StaticWorld::member(body) && !(transform == body->getWorldTransform()))
+				{
+					// it moved after all; raycast it through Bullet from now on
+					i.item()->flags &= ~RigidBody::FlagStaticWorld;
+					StaticWorld::dirty();
+				}
 				body->setWorldTransform(transform);
 				body->setInterpolationWorldTransform(transform);
 			}
 		}
 	}
+	r64 time = platform::time() - start;
+	stats.sync_static_time = r32(time);
+	stats.sync_static.add(microseconds(time));
 }
 
 void Physics::sync_dynamic()
 {
+	if (step.id != stats.last.id)
+	{
+		// the physics thread is waiting on us, so it's safe to read its results
+		stats.last = step;
+		stats.step.add(microseconds(step.time));
+		stats.steps++;
+		stats.substeps += u64(step.substeps);
+	}
+
+	r64 start = platform::time();
 	for (auto i = RigidBody::list.iterator(); !i.is_last(); i.next())
 	{
 #if SERVER
@@ -58,9 +190,9 @@ void Physics::sync_dynamic()
 				i.item()->get<Transform>()->set_bullet(body->getInterpolationWorldTransform());
 		}
 	}
-
-	ShellCasing::sync_physics();
-	GlassShard::sync_physics();
+	r64 time = platform::time() - start;
+	stats.sync_dynamic_time = r32(time);
+	stats.sync_dynamic.add(microseconds(time));
 }
 
 RaycastCallbackExcept::RaycastCallbackExcept(const Vec3& a, const Vec3& b, const Entity* entity)
@@ -100,13 +232,62 @@ btScalar RaycastCallbackExcept::addSingleResult(btCollisionWorld::LocalRayResult
 	return rayResult.m_hitFraction;
 }
 
+// passes everything outside the static world through to another callback
+struct RaycastSkipStatic : btCollisionWorld::RayResultCallback
+{
+	btCollisionWorld::RayResultCallback* inner;
+
+	RaycastSkipStatic(btCollisionWorld::RayResultCallback* i)
+		: inner(i)
+	{
+		m_flags = inner->m_flags;
+		m_collisionFilterMask = inner->m_collisionFilterMask;
+		m_collisionFilterGroup = inner->m_collisionFilterGroup;
+		m_closestHitFraction = inner->m_closestHitFraction;
+		m_collisionObject = inner->m_collisionObject;
+	}
+
+	virtual bool needsCollision(btBroadphaseProxy* proxy) const
+	{
+		return !StaticWorld::member((const btCollisionObject*)proxy->m_clientObject) && inner->needsCollision(proxy);
+	}
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& result, b8 normal_in_world_space)
+	{
+		inner->addSingleResult(result, normal_in_world_space);
+		m_closestHitFraction = inner->m_closestHitFraction;
+		m_collisionObject = inner->m_collisionObject;
+		return m_closestHitFraction;
+	}
+};
+
 void Physics::raycast(btCollisionWorld::ClosestRayResultCallback* ray_callback, s16 mask)
 {
 	ray_callback->m_flags = btTriangleRaycastCallback::EFlags::kF_FilterBackfaces
 		| btTriangleRaycastCallback::EFlags::kF_KeepUnflippedNormal;
 	ray_callback->m_collisionFilterMask = mask;
 	ray_callback->m_collisionFilterGroup = -1;
-	Physics::btWorld->rayTest(ray_callback->m_rayFromWorld, ray_callback->m_rayToWorld, *ray_callback);
+	StaticWorld::update();
+	StaticWorld::raycast(ray_callback->m_rayFromWorld, ray_callback->m_rayToWorld, ray_callback);
+	if (!StaticWorld::covers(mask))
+	{
+		RaycastSkipStatic callback(ray_callback);
+		Physics::btWorld->rayTest(ray_callback->m_rayFromWorld, ray_callback->m_rayToWorld, callback);
+	}
+}
+
+void Physics::raycast_outside_static_world(btCollisionWorld::ClosestRayResultCallback* ray_callback, s16 mask)
+{
+	ray_callback->m_flags = btTriangleRaycastCallback::EFlags::kF_FilterBackfaces
+		| btTriangleRaycastCallback::EFlags::kF_KeepUnflippedNormal;
+	ray_callback->m_collisionFilterMask = mask;
+	ray_callback->m_collisionFilterGroup = -1;
+	StaticWorld::update();
+	if (!StaticWorld::covers(mask))
+	{
+		RaycastSkipStatic callback(ray_callback);
+		Physics::btWorld->rayTest(ray_callback->m_rayFromWorld, ray_callback->m_rayToWorld, callback);
+	}
 }
 
 void Physics::raycast(btCollisionWorld::AllHitsRayResultCallback* ray_callback, s16 mask)
@@ -118,6 +299,286 @@ void Physics::raycast(btCollisionWorld::AllHitsRayResultCallback* ray_callback,
 	Physics::btWorld->rayTest(ray_callback->m_rayFromWorld, ray_callback->m_rayToWorld, *ray_callback);
 }
 
+#define RAYCAST_BATCH_GRAIN 16 // rays per job chunk
+
+struct RaycastBatchCallback : btCollisionWorld::ClosestRayResultCallback
+{
+	s32 ignore;
+
+	RaycastBatchCallback(const Raycast& ray)
+		: btCollisionWorld::ClosestRayResultCallback(ray.start, ray.end),
+		ignore(ray.ignore == IDNull ? -1 : s32(ray.ignore))
+	{
+		m_flags = btTriangleRaycastCallback::EFlags::kF_FilterBackfaces
+			| btTriangleRaycastCallback::EFlags::kF_KeepUnflippedNormal;
+		m_collisionFilterMask = ray.mask;
+		m_collisionFilterGroup = -1;
+	}
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& result, b8 normal_in_world_space)
+	{
+		if (ignore != -1 && result.m_collisionObject->getUserIndex() == ignore)
+			return m_closestHitFraction;
+		return btCollisionWorld::ClosestRayResultCallback::addSingleResult(result, normal_in_world_space);
+	}
+};
+
+// visits broadphase leaves along a ray. same as btCollisionWorld::rayTest, minus the broadphase's shared traversal stack
+struct RaycastBatchLeaf : btDbvt::ICollide
+{
+	btTransform from;
+	btTransform to;
+	RaycastBatchCallback* callback;
+
+	void Process(const btDbvtNode* leaf)
+	{
+		if (callback->m_closestHitFraction == 0.0f)
+			return;
+		btCollisionObject* object = (btCollisionObject*)(((btDbvtProxy*)leaf->data)->m_clientObject);
+		if (!StaticWorld::member(object) && callback->needsCollision(object->getBroadphaseHandle()))
+			btCollisionWorld::rayTestSingle(from, to, object, object->getCollisionShape(), object->getWorldTransform(), *callback);
+	}
+};
+
+struct RaycastBatch
+{
+	const Raycast* rays;
+	RaycastHit* hits;
+};
+
+void raycast_batch_range(s32 start, s32 end, void* data)
+{
+	const RaycastBatch* batch = (const RaycastBatch*)data;
+	btAlignedObjectArray<const btDbvtNode*> stack; // reused by every ray in the range
+	const btVector3 aabb_zero(0, 0, 0);
+	for (s32 i = start; i < end; i++)
+	{
+		const Raycast& ray = batch->rays[i];
+		RaycastHit* hit = &batch->hits[i];
+		hit->fraction = 1.0f;
+		hit->object = nullptr;
+
+		btVector3 from = ray.start;
+		btVector3 to = ray.end;
+		btVector3 dir = to - from;
+		btScalar length = dir.length();
+		if (length == 0.0f)
+			continue;
+		dir /= length;
+
+		btVector3 dir_inverse
+		(
+			dir[0] == 0.0f ? btScalar(BT_LARGE_FLOAT) : 1.0f / dir[0],
+			dir[1] == 0.0f ? btScalar(BT_LARGE_FLOAT) : 1.0f / dir[1],
+			dir[2] == 0.0f ? btScalar(BT_LARGE_FLOAT) : 1.0f / dir[2]
+		);
+		u32 signs[3] = { dir_inverse[0] < 0.0f, dir_inverse[1] < 0.0f, dir_inverse[2] < 0.0f };
+
+		RaycastBatchCallback callback(ray);
+		RaycastBatchLeaf leaf;
+		leaf.from.setIdentity();
+		leaf.from.setOrigin(from);
+		leaf.to.setIdentity();
+		leaf.to.setOrigin(to);
+		leaf.callback = &callback;
+
+		StaticWorld::raycast(ray.start, ray.end, &callback);
+		if (!StaticWorld::covers(ray.mask))
+		{
+			for (s32 j = 0; j < 2; j++)
+			{
+				const btDbvt& tree = Physics::broadphase->m_sets[j];
+				tree.rayTestInternal(tree.m_root, from, to, dir_inverse, signs, length, aabb_zero, aabb_zero, stack, leaf);
+			}
+		}
+
+		if (callback.hasHit())
+		{
+			hit->pos = callback.m_hitPointWorld;
+			hit->normal = callback.m_hitNormalWorld;
+			hit->fraction = callback.m_closestHitFraction;
+			hit->object = callback.m_collisionObject;
+		}
+	}
+}
+
+void Physics::raycast_batch(const Raycast* rays, RaycastHit* hits, s32 count)
+{
+	r64 start = platform::time();
+
+	if (raycast_batch_per_ray)
+	{
+		for (s32 i = 0; i < count; i++)
+		{
+			RaycastBatchCallback callback(rays[i]);
+			raycast(&callback, rays[i].mask);
+			RaycastHit* hit = &hits[i];
+			if (callback.hasHit())
+			{
+				hit->pos = callback.m_hitPointWorld;
+				hit->normal = callback.m_hitNormalWorld;
+				hit->fraction = callback.m_closestHitFraction;
+				hit->object = callback.m_collisionObject;
+			}
+			else
+			{
+				hit->fraction = 1.0f;
+				hit->object = nullptr;
+			}
+		}
+	}
+	else
+	{
+		RaycastBatch batch;
+		batch.rays = rays;
+		batch.hits = hits;
+		StaticWorld::update();
+		Jobs::parallel_for(count, RAYCAST_BATCH_GRAIN, &raycast_batch_range, &batch);
+	}
+
+	stats.raycast_batch_time += platform::time() - start;
+	stats.raycast_batch_rays += u64(count);
+}
+
+// bodies with the same type and size (or mesh) share one collision shape.
+// shapes are freed on level unload once nothing uses them; mesh shapes point into mesh data, so they also go when their meshes do
+struct ShapeKey
+{
+	Vec3 size; // zero for meshes
+	AssetID mesh_id; // AssetNull for primitives
+	RigidBody::Type type;
+
+	b8 operator==(const ShapeKey& other) const
+	{
+		return type == other.type && mesh_id == other.mesh_id && size == other.size;
+	}
+};
+
+struct ShapeKeyHash
+{
+	size_t operator()(const ShapeKey& key) const
+	{
+		size_t hash = (size_t(key.type) << 16) ^ size_t(u16(key.mesh_id));
+		for (s32 i = 0; i < 3; i++)
+		{
+			r32 value = key.size[i] + 0.0f; // -0 and 0 compare equal, so they have to hash the same
+			u32 bits;
+			memcpy(&bits, &value, sizeof(bits));
+			hash = hash * 31 + bits;
+		}
+		return hash;
+	}
+};
+
+struct ShapeCacheEntry
+{
+	btCollisionShape* shape; // its user pointer points back to this entry
+	btStridingMeshInterface* mesh; // only for Type::Mesh
+	s32 refs;
+};
+
+std::unordered_map<ShapeKey, ShapeCacheEntry, ShapeKeyHash> shape_cache;
+
+btCollisionShape* shape_acquire(RigidBody::Type type, const Vec3& size, AssetID mesh_id, btStridingMeshInterface** out_mesh)
+{
+	ShapeKey key;
+	key.type = type;
+	if (type == RigidBody::Type::Mesh)
+	{
+		key.size = Vec3::zero;
+		key.mesh_id = mesh_id;
+	}
+	else
+	{
+		key.size = size;
+		key.mesh_id = AssetNull;
+	}
+
+	auto existing = shape_cache.find(key);
+	if (existing != shape_cache.end())
+	{
+		ShapeCacheEntry* entry = &existing->second;
+		entry->refs++;
+		*out_mesh = entry->mesh;
+		return entry->shape;
+	}
+
+	ShapeCacheEntry* entry = &shape_cache[key];
+	entry->mesh = nullptr;
+	entry->refs = 1;
+
+	switch (type)
+	{
+		case RigidBody::Type::Box:
+			entry->shape = new btBoxShape(size);
+			break;
+		case RigidBody::Type::CapsuleX:
+			entry->shape = new btCapsuleShapeX(size.x, size.y);
+			break;
+		case RigidBody::Type::CapsuleY:
+			entry->shape = new btCapsuleShape(size.x, size.y);
+			break;
+		case RigidBody::Type::CapsuleZ:
+			entry->shape = new btCapsuleShapeZ(size.x, size.y);
+			break;
+		case RigidBody::Type::Sphere:
+			entry->shape = new btSphereShape(size.x);
+			break;
+		case RigidBody::Type::Mesh:
+		{
+			const Mesh* mesh = Loader::mesh(mesh_id);
+			r64 start = platform::time();
+			entry->mesh = new btTriangleIndexVertexArray(mesh->indices.length / 3, mesh->indices.data, 3 * sizeof(s32), mesh->vertices.length, (btScalar*)mesh->vertices.data, sizeof(Vec3));
+			btOptimizedBvh* bvh = Loader::mesh_bvh(mesh_id);
+			if (bvh)
+			{
+				// use the BVH the importer built rather than building it here
+				btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(entry->mesh, true, mesh->bounds_min, mesh->bounds_max, false);
+				shape->setOptimizedBvh(bvh);
+				entry->shape = shape;
+				Physics::stats.mesh_shapes_loaded++;
+			}
+			else
+			{
+				entry->shape = new btBvhTriangleMeshShape(entry->mesh, true, mesh->bounds_min, mesh->bounds_max);
+				Physics::stats.mesh_shapes_built++;
+			}
+			Physics::stats.mesh_shape_time += platform::time() - start;
+			break;
+		}
+		default:
+			vi_assert(false);
+			break;
+	}
+
+	entry->shape->setUserPointer(entry); // map entries don't move
+	*out_mesh = entry->mesh;
+	return entry->shape;
+}
+
+void shape_release(btCollisionShape* shape)
+{
+	ShapeCacheEntry* entry = (ShapeCacheEntry*)shape->getUserPointer();
+	vi_assert(entry && entry->shape == shape && entry->refs > 0);
+	entry->refs--;
+}
+
+void Physics::shape_cache_purge(b8 keep_meshes)
+{
+	for (auto i = shape_cache.begin(); i != shape_cache.end();)
+	{
+		const ShapeCacheEntry& entry = i->second;
+		if (entry.refs == 0 && (!keep_meshes || i->first.type != RigidBody::Type::Mesh))
+		{
+			delete entry.shape;
+			delete entry.mesh;
+			i = shape_cache.erase(i);
+		}
+		else
+			i++;
+	}
+}
+
 PinArray<RigidBody::Constraint, MAX_ENTITIES> RigidBody::global_constraints;
 
 RigidBody::RigidBody(Type type, const Vec3& size, r32 mass, s16 group, s16 mask, AssetID mesh_id, s8 flags)
@@ -192,34 +653,7 @@ void RigidBody::awake()
 		);
 	}
 
-	switch (type)
-	{
-		case Type::Box:
-			btShape = new btBoxShape(size);
-			break;
-		case Type::CapsuleX:
-			btShape = new btCapsuleShapeX(size.x, size.y);
-			break;
-		case Type::CapsuleY:
-			btShape = new btCapsuleShape(size.x, size.y);
-			break;
-		case Type::CapsuleZ:
-			btShape = new btCapsuleShapeZ(size.x, size.y);
-			break;
-		case Type::Sphere:
-			btShape = new btSphereShape(size.x);
-			break;
-		case Type::Mesh:
-		{
-			const Mesh* mesh = Loader::mesh(mesh_id);
-			btMesh = new btTriangleIndexVertexArray(mesh->indices.length / 3, mesh->indices.data, 3 * sizeof(s32), mesh->vertices.length, (btScalar*)mesh->vertices.data, sizeof(Vec3));
-			btShape = new btBvhTriangleMeshShape(btMesh, true, mesh->bounds_min, mesh->bounds_max);
-			break;
-		}
-		default:
-			vi_assert(false);
-			break;
-	}
+	btShape = shape_acquire(type, size, mesh_id, &btMesh);
 
 	btVector3 localInertia(0, 0, 0);
 	if (m > 0.0f)
@@ -245,6 +679,11 @@ void RigidBody::awake()
 
 	Physics::btWorld->addRigidBody(btBody, collision_group, actual_collision_filter);
 
+	if (flags & FlagStaticWorld)
+		StaticWorld::dirty();
+	else
+		StaticWorld::track(collision_group);
+
 	// rebuild constraints
 
 #if SERVER
@@ -270,12 +709,12 @@ RigidBody::~RigidBody()
 	remove_all_constraints();
 	if (btBody)
 	{
+		if (StaticWorld::member(btBody))
+			StaticWorld::dirty();
 		Physics::btWorld->removeRigidBody(btBody);
 		delete btBody;
-		delete btShape;
+		shape_release(btShape);
 	}
-	if (btMesh)
-		delete btMesh;
 }
 
 void RigidBody::set_restitution(r32 r)
@@ -338,6 +777,10 @@ void RigidBody::set_collision_masks(s16 group, s16 filter)
 		collision_filter = filter;
 		if (btBody)
 		{
+			if (StaticWorld::member(btBody))
+				StaticWorld::dirty();
+			else
+				StaticWorld::track(group);
 			Physics::btWorld->removeRigidBody(btBody);
 			Physics::btWorld->addRigidBody(btBody, group, filter);
 		}
@@ -368,11 +811,11 @@ void RigidBody::rebuild()
 	// delete body
 	if (btBody)
 	{
+		if (StaticWorld::member(btBody))
+			StaticWorld::dirty();
 		Physics::btWorld->removeRigidBody(btBody);
 		delete btBody;
-		delete btShape;
-		if (btMesh)
-			delete btMesh;
+		shape_release(btShape);
 		btMesh = nullptr;
 		btBody = nullptr;
 		btShape = nullptr;
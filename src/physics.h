@@ -6,6 +6,7 @@
 #include "data/entity.h"
 #include "lmath.h"
 #include "sync.h"
+#include "tick.h"
 
 namespace VI
 {
@@ -39,6 +40,8 @@ enum CollisionGroup : s16
 #define DRONE_PERMEABLE_MASK (CollisionTarget | CollisionDroneIgnore | CollisionDefault | CollisionWalker | CollisionMinionMoving)
 #define DRONE_INACCESSIBLE_MASK (CollisionInaccessible | CollisionElectric | DRONE_PERMEABLE_MASK | CollisionAllTeamsForceField | CollisionGlass)
 
+#define STATIC_GEOM_RESTITUTION 0.75f // Bullet multiplies this with the restitution of anything that bounces off level geometry
+
 struct RaycastCallbackExcept : btCollisionWorld::ClosestRayResultCallback
 {
 	Array<ID> additional_ids;
@@ -48,6 +51,23 @@ struct RaycastCallbackExcept : btCollisionWorld::ClosestRayResultCallback
 	void ignore(const Entity*);
 };
 
+// one ray in a batch. see Physics::raycast_batch
+struct Raycast
+{
+	Vec3 start;
+	Vec3 end;
+	ID ignore; // entity to skip, or IDNull
+	s16 mask;
+};
+
+struct RaycastHit
+{
+	Vec3 pos;
+	Vec3 normal;
+	r32 fraction; // 1.0 if nothing was hit
+	const btCollisionObject* object; // null if nothing was hit
+};
+
 struct PhysicsSync
 {
 	b8 quit;
@@ -57,6 +77,33 @@ struct PhysicsSync
 
 typedef Sync<PhysicsSync, 1>::Swapper PhysicsSwapper;
 
+struct PhysicsStep
+{
+	r32 time; // seconds spent in stepSimulation
+	s32 substeps;
+	s32 bodies_active; // dynamic bodies still awake afterward
+	s32 manifolds;
+	s32 contacts;
+	u32 id; // incremented every step
+};
+
+struct PhysicsStats
+{
+	Tick::Histogram step; // microseconds, one sample per step
+	Tick::Histogram sync_static;
+	Tick::Histogram sync_dynamic;
+	PhysicsStep last;
+	u64 steps;
+	u64 substeps;
+	r32 sync_static_time; // most recent call, in seconds
+	r32 sync_dynamic_time;
+	r64 raycast_batch_time; // seconds spent in raycast_batch, summed over every call
+	u64 raycast_batch_rays;
+	r64 mesh_shape_time; // seconds spent creating mesh collision shapes, including reading their BVHs, summed over every shape
+	u32 mesh_shapes_loaded; // BVH read from the importer's .bvh file
+	u32 mesh_shapes_built; // no usable .bvh file, so Bullet built the BVH
+};
+
 struct Physics
 {
 	static btDbvtBroadphase* broadphase;
@@ -64,13 +111,21 @@ struct Physics
 	static btCollisionDispatcher* dispatcher;
 	static btSequentialImpulseConstraintSolver* solver;
 	static btDiscreteDynamicsWorld* btWorld;
+	static PhysicsStep step; // most recent step; written by the physics thread
+	static PhysicsStats stats; // update thread only. sync_dynamic folds in each step while the physics thread is waiting
+	static b8 multithreaded;
+	static b8 raycast_batch_per_ray; // send batched rays one at a time through raycast() instead, to compare the two
 
+	static void init(b8); // call once before the physics thread starts. true = step islands in parallel on the job pool
 	static void loop(PhysicsSwapper*);
 	static void sync_static();
 	static void sync_dynamic();
 
 	static void raycast(btCollisionWorld::ClosestRayResultCallback*, s16 = ~CollisionTarget & ~CollisionWalker);
 	static void raycast(btCollisionWorld::AllHitsRayResultCallback*, s16 = ~CollisionTarget & ~CollisionWalker);
+	static void raycast_outside_static_world(btCollisionWorld::ClosestRayResultCallback*, s16 = ~CollisionTarget & ~CollisionWalker); // same as raycast, minus level geometry
+	static void raycast_batch(const Raycast*, RaycastHit*, s32); // closest hit for each ray. large batches are split across the job pool. update thread only
+	static void shape_cache_purge(b8); // frees unused shapes. pass true if the meshes are staying loaded, to keep their shapes around
 };
 
 struct RigidBody : public ComponentType<RigidBody>
@@ -111,8 +166,8 @@ struct RigidBody : public ComponentType<RigidBody>
 	static void remove_constraint(ID);
 	static void rebuild_constraint(ID);
 
-	btCollisionShape* btShape;
-	btStridingMeshInterface* btMesh;
+	btCollisionShape* btShape; // shared with other bodies; owned by the shape cache
+	btStridingMeshInterface* btMesh; // same
 	btRigidBody* btBody;
 	Vec3 size;
 	Vec2 damping; // use set_damping to ensure the btBody will be updated
@@ -128,6 +183,7 @@ struct RigidBody : public ComponentType<RigidBody>
 	static const s8 FlagHasConstraints = 1 << 1;
 	static const s8 FlagGhost = 1 << 2; // ghost rigidbodies still exist, but don't collide or move or affect constraints. Only servers have ghost objects. Clients always simulate everything.
 	static const s8 FlagAudioReflector = 1 << 3;
+	static const s8 FlagStaticWorld = 1 << 4; // level geometry that never moves. raycasts test it through StaticWorld instead of Bullet
 
 	RigidBody(Type, const Vec3&, r32, s16, s16, AssetID = AssetNull, s8 = 0);
 	RigidBody();
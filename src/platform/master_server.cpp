@@ -371,6 +371,8 @@ namespace Master
 		Array<u64> servers;
 		Array<u64> clients_waiting;
 		Array<ClientConnection> clients_connecting;
+		StreamRead packet_received; // reused for every packet rather than constructed and zeroed each time
+		StreamRead packet_decoded;
 	};
 	Global global;
 
@@ -2660,15 +2662,16 @@ namespace Master
 			}
 
 			Sock::Address addr;
-			StreamRead packet;
-			s32 bytes_read = Sock::udp_receive(&global.sock, &addr, packet.data.data, NET_MAX_PACKET_SIZE);
-			packet.resize_bytes(bytes_read);
+			StreamRead* packet = &global.packet_received;
+			packet->reset();
+			s32 bytes_read = Sock::udp_receive(&global.sock, &addr, packet->data.data, NET_MAX_PACKET_SIZE);
 			if (bytes_read > 0)
 			{
-				if (packet.read_checksum())
+				packet->resize_bytes(bytes_read);
+				if (packet->read_checksum())
 				{
-					packet_decompress(&packet, bytes_read);
-					packet_handle(&packet, addr);
+					packet_decompress(packet, &global.packet_decoded);
+					packet_handle(&global.packet_decoded, addr);
 				}
 				else
 					vi_debug("%s", "Discarding packet due to invalid checksum.");
@@ -11,6 +11,7 @@
 #include <thread>
 #include "physics.h"
 #include "loop.h"
+#include "jobs.h"
 #include "settings.h"
 #if _WIN32
 #include <Windows.h>
@@ -524,6 +525,9 @@ namespace VI
 		PhysicsSwapper swapper_physics = physics_sync.swapper();
 		PhysicsSwapper swapper_physics_update = physics_sync.swapper();
 
+		Jobs::init();
+		Physics::init(Settings::physics_multithreaded);
+
 		std::thread thread_physics(Physics::loop, &swapper_physics);
 
 		std::thread thread_update(Loop::loop, &swapper_render_update, &swapper_physics_update);
@@ -1081,6 +1085,8 @@ namespace VI
 		thread_physics.join();
 		thread_ai.join();
 
+		Jobs::term();
+
 		SDL_GL_DeleteContext(context);
 		SDL_DestroyWindow(window);
 
@@ -7,12 +7,19 @@
 #include "physics.h"
 #include "loop.h"
 #include "settings.h"
+#include "metrics.h"
+#include "benchmark.h"
+#include "jobs.h"
 #if _WIN32
 #include <Windows.h>
 #endif
 #include <time.h>
 #include <chrono>
 #include <signal.h>
+#if !_WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 namespace VI
 {
@@ -49,7 +56,8 @@ namespace VI
 
 	}
 
-	s32 proc(u16 port)
+	// everything that happens once per process, before any threads start
+	s32 init()
 	{
 		signal(SIGINT, platform::signal_handle);
 		signal(SIGTERM, platform::signal_handle);
@@ -61,8 +69,6 @@ namespace VI
 			Loader::settings_load(modes, { 0, 0 });
 		}
 
-		Settings::port = port;
-
 		{
 			const char* error;
 			if (Game::pre_init(&error) == Game::PreinitResult::Failure)
@@ -72,50 +78,277 @@ namespace VI
 			}
 		}
 
+		return 0;
+	}
+
+	// runs one match until quit
+	s32 run(u16 port)
+	{
+		Settings::port = port;
+
 		// launch threads
 
-		Sync<LoopSync> render_sync;
+		Sync<LoopSync> render_sync; // headless; only one side is ever used. see Loop::loop
 
 		LoopSwapper update_swapper = render_sync.swapper(0);
-		LoopSwapper render_swapper = render_sync.swapper(1);
 
 		Sync<PhysicsSync, 1> physics_sync;
 
 		PhysicsSwapper physics_swapper = physics_sync.swapper();
 		PhysicsSwapper physics_update_swapper = physics_sync.swapper();
 
-		std::thread physics_thread(Physics::loop, &physics_swapper);
+		Jobs::init();
+		Physics::init(Settings::physics_multithreaded);
 
-		std::thread update_thread(Loop::loop, &update_swapper, &physics_update_swapper);
+		std::thread physics_thread(Physics::loop, &physics_swapper);
 
 		std::thread ai_thread(AI::loop);
 
-		LoopSync* sync = render_swapper.get();
+		b8 metrics = !Benchmark::active();
+		if (metrics)
+			Metrics::init(port);
 
-		while (true)
-		{
-			sync->quit |= platform::quit;
-			b8 quit = sync->quit;
-
-			sync = render_swapper.swap<SwapType::Read>();
+		// no render thread; the update loop runs right here
+		Loop::loop(&update_swapper, &physics_update_swapper);
 
-			if (quit || sync->quit)
-				break;
-		}
+		if (metrics)
+			Metrics::term();
 
 		AI::quit();
 
-		update_thread.join();
 		physics_thread.join();
 		ai_thread.join();
 
+		Jobs::term();
+
 		return 0;
 	}
 
+	s32 proc(u16 port)
+	{
+		s32 result = init();
+		if (result)
+			return result;
+		return run(port);
+	}
+
+#if !_WIN32
+#define ZYGOTE_RESPAWN_DELAY 1.0f
+#define ZYGOTE_POLL_INTERVAL 0.25f
+#define ZYGOTE_STATS_INTERVAL 60.0f
+
+	namespace Zygote
+	{
+		struct Child
+		{
+			pid_t pid;
+			u16 port;
+			r64 spawn_time;
+		};
+
+		Array<Child> children;
+
+		void spawn(Child* child)
+		{
+			r64 start = platform::time();
+			fflush(stdout); // otherwise the child inherits and repeats anything still buffered
+			fflush(stderr);
+			pid_t pid = fork();
+			if (pid == 0)
+			{
+				children.length = 0;
+				exit(run(child->port));
+			}
+			else if (pid < 0)
+			{
+				fprintf(stderr, "Failed to fork match on port %d.\n", s32(child->port));
+				child->pid = 0;
+			}
+			else
+			{
+				child->pid = pid;
+				child->spawn_time = start;
+				printf("Match on port %d forked as pid %d in %.1fms.\n", s32(child->port), s32(pid), (platform::time() - start) * 1000.0);
+			}
+		}
+
+		// proportional set size in KB; shared pages are split evenly between the processes mapping them
+		s64 pss(pid_t pid)
+		{
+			char path[64];
+			snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", s32(pid));
+			FILE* f = fopen(path, "r");
+			if (!f)
+				return -1;
+			s64 result = -1;
+			char line[256];
+			while (fgets(line, sizeof(line), f))
+			{
+				if (sscanf(line, "Pss: %lld kB", (long long*)&result) == 1)
+					break;
+			}
+			fclose(f);
+			return result;
+		}
+
+		void stats()
+		{
+			s64 total = pss(getpid());
+			printf("Zygote: %lldkB PSS.", (long long)total);
+			for (s32 i = 0; i < children.length; i++)
+			{
+				if (!children[i].pid)
+					continue;
+				s64 p = pss(children[i].pid);
+				printf(" Port %d: %lldkB PSS.", s32(children[i].port), (long long)p);
+				total += p;
+			}
+			printf(" Total: %lldkB.\n", (long long)total);
+		}
+
+		// loads shared assets once, then forks one match per port and restarts any that crash
+		s32 proc(const Array<u16>& ports)
+		{
+			s32 result = init();
+			if (result)
+				return result;
+
+			{
+				r64 start = platform::time();
+				Loader::preload();
+				printf("Zygote: assets loaded in %.1fms.\n", (platform::time() - start) * 1000.0);
+			}
+
+			for (s32 i = 0; i < ports.length; i++)
+			{
+				Child* child = children.add();
+				child->port = ports[i];
+				spawn(child);
+			}
+
+			r64 last_stats = platform::time();
+			while (!platform::quit)
+			{
+				s32 status;
+				pid_t pid = waitpid(-1, &status, WNOHANG);
+				if (pid > 0)
+				{
+					for (s32 i = 0; i < children.length; i++)
+					{
+						Child* child = &children[i];
+						if (child->pid == pid)
+						{
+							child->pid = 0;
+							if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+								printf("Match on port %d exited.\n", s32(child->port));
+							else
+							{
+								fprintf(stderr, "Match on port %d died after %.0fs (status %d). Restarting.\n", s32(child->port), platform::time() - child->spawn_time, status);
+								platform::sleep(ZYGOTE_RESPAWN_DELAY);
+								spawn(child);
+							}
+							break;
+						}
+					}
+				}
+				else
+				{
+					platform::sleep(ZYGOTE_POLL_INTERVAL);
+					if (platform::time() - last_stats > ZYGOTE_STATS_INTERVAL)
+					{
+						stats();
+						last_stats = platform::time();
+					}
+				}
+			}
+
+			for (s32 i = 0; i < children.length; i++)
+			{
+				if (children[i].pid)
+					kill(children[i].pid, SIGTERM);
+			}
+			for (s32 i = 0; i < children.length; i++)
+			{
+				if (children[i].pid)
+					waitpid(children[i].pid, nullptr, 0);
+			}
+
+			return 0;
+		}
+	}
+#endif
+
 }
 
 int main(int argc, char** argv)
 {
+#if !_WIN32
+	if (argc >= 2 && strcmp(argv[1], "--zygote") == 0)
+	{
+		VI::Array<VI::u16> ports;
+		for (int i = 2; i < argc; i++)
+		{
+			int port = atoi(argv[i]);
+			if (port <= 0 || port > 65535)
+			{
+				fprintf(stderr, "%s\n", "Invalid port number specified.");
+				return -1;
+			}
+			ports.add(VI::u16(port));
+		}
+		if (ports.length == 0)
+		{
+			fprintf(stderr, "%s\n", "Usage: deceiversrv --zygote <port> [port...]");
+			return -1;
+		}
+		return VI::Zygote::proc(ports);
+	}
+#endif
+
+#if BENCHMARK
+	if (argc >= 2 && strcmp(argv[1], "--benchmark") == 0)
+	{
+		VI::Benchmark::Config config = {};
+		config.game_type = VI::GameType::count;
+		if (argc >= 4)
+		{
+			config.level = argv[2];
+			for (VI::s32 i = 0; i < VI::s32(VI::GameType::count); i++)
+			{
+				if (strcmp(argv[3], VI::Net::Master::ServerConfig::game_type_string(VI::GameType(i))) == 0)
+					config.game_type = VI::GameType(i);
+			}
+		}
+		config.scenario = VI::Benchmark::Scenario::Match;
+		if (argc >= 7)
+		{
+			config.scenario = VI::Benchmark::Scenario::count;
+			for (VI::s32 i = 0; i < VI::s32(VI::Benchmark::Scenario::count); i++)
+			{
+				if (strcmp(argv[6], VI::Benchmark::scenario_string(VI::Benchmark::Scenario(i))) == 0)
+					config.scenario = VI::Benchmark::Scenario(i);
+			}
+		}
+		VI::b8 raycasts_valid = true;
+		if (argc >= 8)
+		{
+			if (strcmp(argv[7], "per-ray") == 0)
+				config.raycasts_per_ray = true;
+			else if (strcmp(argv[7], "batched") != 0)
+				raycasts_valid = false;
+		}
+		if (config.game_type == VI::GameType::count || config.scenario == VI::Benchmark::Scenario::count || !raycasts_valid)
+		{
+			fprintf(stderr, "%s\n", "Usage: deceiverbench --benchmark <level> <as|dm|ctf> [simulated seconds] [seed] [match|walkers|ragdolls|glass] [batched|per-ray]");
+			return -1;
+		}
+		config.duration = argc >= 5 ? VI::r32(atof(argv[4])) : 0.0f;
+		config.seed = argc >= 6 ? VI::u32(strtoul(argv[5], nullptr, 10)) : 1;
+		VI::Benchmark::init(config);
+		return VI::proc(0); // any free port; nobody connects
+	}
+#endif
+
 	int port;
 
 	if (argc >= 2)
@@ -10,6 +10,9 @@ namespace platform
 u64 timestamp();
 r64 time();
 void sleep(r32);
+#if SERVER
+extern b8 quit; // set by signal handlers
+#endif
 
 }
 
@@ -381,6 +381,8 @@ const r32 rain_radius = 30.0f;
 const r32 rain_interval_multiplier = 0.00075f;
 const r32 rain_raycast_grid_cell_size = (rain_radius * 2.0f) / Rain::raycast_grid_size;
 r32 Rain::audio_kernel[raycast_grid_size * raycast_grid_size];
+Array<Raycast> rain_rays;
+Array<RaycastHit> rain_hits;
 r32 Rain::particle_accumulator;
 Ref<AudioEntry> Rain::audio_entries[MAX_GAMEPADS];
 
@@ -489,18 +491,34 @@ void Rain::spawn(const Update& u, r32 strength)
 					every_other = false;
 				}
 
+				// collect this frame's cells and raycast them in one batch
+				rain_rays.length = 0;
+				{
+					s32 index = rain->raycast_grid_index;
+					for (s32 i = 0; i < local_raycasts_per_frame; i++)
+					{
+						if (!every_other || (i % 2) == 0) // this only works when the grid size is a power of 2; otherwise a raycast from row N might carry over row N+1
+						{
+							Vec3 ray_start = camera.pos + rain_cell_offset(index);
+							ray_start.y += 150.0f;
+							Vec3 ray_end = ray_start;
+							ray_end.y = camera.pos.y + rain_radius - height;
+							rain_rays.add({ ray_start, ray_end, IDNull, CollisionStatic });
+						}
+						index = (index + 1) % (raycast_grid_size * raycast_grid_size);
+					}
+				}
+				rain_hits.resize(rain_rays.length);
+				Physics::raycast_batch(rain_rays.data, rain_hits.data, rain_rays.length);
+
 				r32 last_result = rain_radius - height;
+				s32 ray = 0;
 				for (s32 i = 0; i < local_raycasts_per_frame; i++)
 				{
-					if (!every_other || (i % 2) == 0) // this only works when the grid size is a power of 2; otherwise a raycast from row N might carry over row N+1
+					if (!every_other || (i % 2) == 0)
 					{
-						Vec3 ray_start = camera.pos + rain_cell_offset(rain->raycast_grid_index);
-						ray_start.y += 150.0f;
-						Vec3 ray_end = ray_start;
-						ray_end.y = camera.pos.y + rain_radius - height;
-						btCollisionWorld::ClosestRayResultCallback ray_callback(ray_start, ray_end);
-						Physics::raycast(&ray_callback, CollisionStatic);
-						last_result = ray_callback.hasHit() ? ray_callback.m_hitPointWorld.getY() : ray_end.y;
+						last_result = rain_hits[ray].object ? rain_hits[ray].pos.y : rain_rays[ray].end.y;
+						ray++;
 					}
 					rain->raycast_grid[rain->raycast_grid_index] = last_result;
 					rain->raycast_grid_index = (rain->raycast_grid_index + 1) % (raycast_grid_size * raycast_grid_size);
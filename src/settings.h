@@ -90,6 +90,7 @@ namespace Settings
 	extern b8 god_mode;
 	extern b8 quick_combat_unlocked;
 	extern b8 parkour_reticle;
+	extern b8 physics_multithreaded;
 
 	const DisplayMode& display();
 };
@@ -0,0 +1,98 @@
+#include "shed.h"
+#include "vi_assert.h"
+#include "tick.h"
+#include "metrics.h"
+#include <stdio.h>
+
+namespace VI
+{
+
+namespace Shed
+{
+
+#define SHED_SMOOTHING 0.05f // weight of each new tick in the running load average
+#define SHED_RAISE_LOAD 0.9f // fraction of the tick budget
+#define SHED_RAISE_TIME 1.0f // seconds of sustained overrun before stepping down
+#define SHED_LOWER_LOAD 0.5f
+#define SHED_LOWER_TIME 5.0f // seconds of headroom before stepping back up
+
+const char* level_names[s32(Level::count)] =
+{
+	"none",
+	"bots",
+	"visibility",
+	"state_frames",
+};
+
+struct State
+{
+	r32 load; // smoothed tick duration as a fraction of the budget
+	r32 raise_timer;
+	r32 lower_timer;
+	u64 changes;
+	Level level;
+};
+State state;
+
+Level level()
+{
+	return state.level;
+}
+
+b8 active(Level l)
+{
+	return s32(state.level) >= s32(l);
+}
+
+void level_set(Level l)
+{
+	vi_debug("Load shedding: %s -> %s (tick load %.0f%%)", level_names[s32(state.level)], level_names[s32(l)], state.load * 100.0f);
+	state.level = l;
+	state.changes++;
+	state.raise_timer = 0.0f;
+	state.lower_timer = 0.0f;
+}
+
+void update(r32 budget)
+{
+	if (budget <= 0.0f)
+		return;
+
+	state.load += ((Tick::last() / budget) - state.load) * SHED_SMOOTHING;
+
+	if (state.load > SHED_RAISE_LOAD)
+	{
+		state.lower_timer = 0.0f;
+		state.raise_timer += budget;
+		if (state.raise_timer > SHED_RAISE_TIME && s32(state.level) < s32(Level::count) - 1)
+			level_set(Level(s32(state.level) + 1));
+	}
+	else if (state.load < SHED_LOWER_LOAD)
+	{
+		state.raise_timer = 0.0f;
+		state.lower_timer += budget;
+		if (state.lower_timer > SHED_LOWER_TIME && state.level != Level::None)
+			level_set(Level(s32(state.level) - 1));
+	}
+	else
+	{
+		state.raise_timer = 0.0f;
+		state.lower_timer = 0.0f;
+	}
+}
+
+void metrics(Metrics::Writer* w)
+{
+	w->header("deceiver_tick_load", "gauge", "Smoothed tick duration as a fraction of the tick budget.");
+	w->value("deceiver_tick_load", r64(state.load));
+
+	w->header("deceiver_shed_level", "gauge", "Current load shedding level. 0 means everything runs at full fidelity.");
+	w->value("deceiver_shed_level", r64(state.level));
+
+	w->header("deceiver_shed_changes_total", "counter", "Load shedding level changes.");
+	w->value("deceiver_shed_changes_total", r64(state.changes));
+}
+
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "types.h"
+
+namespace VI
+{
+
+#if SERVER
+namespace Metrics
+{
+	struct Writer;
+}
+#endif
+
+// load shedding. when ticks keep running over budget, the server steps its simulation down a level at a time,
+// and back up once there's headroom again. each level includes everything below it
+namespace Shed
+{
+
+enum class Level : s8
+{
+	None,
+	Bots, // AI players reevaluate their actions less often
+	Visibility, // player visibility is refreshed a few times a second rather than every tick
+	StateFrames, // transforms far from every player are sent at low resolution
+	count,
+};
+
+#if SERVER
+Level level();
+b8 active(Level); // true if the given level is in effect
+void update(r32); // call after every tick with the tick budget in seconds
+void metrics(Metrics::Writer*);
+#else
+inline Level level() { return Level::None; } // only servers shed load
+inline b8 active(Level) { return false; }
+#endif
+
+}
+
+}
@@ -0,0 +1,416 @@
+#include "static_world.h"
+#include "physics.h"
+#include "load.h"
+#include "platform/util.h"
+#include "bullet/src/BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+#include <float.h>
+#include <string.h>
+#include <stdio.h>
+
+namespace VI
+{
+
+namespace StaticWorld
+{
+
+#define STATIC_WORLD_LANES 4 // triangles per leaf, tested together
+#define STATIC_WORLD_STACK 64 // traversal stack entries. a tree of depth d needs d + 1. deeper trees are left to Bullet
+
+struct Node
+{
+	Vec3 bounds_min;
+	s32 offset; // leaf: packet index. interior: index of the second child; the first child comes right after this node
+	Vec3 bounds_max;
+	s32 count; // leaf: triangles in the packet. interior: -(split axis)
+};
+
+// structure-of-arrays, so all lanes go through the same arithmetic
+struct Packet
+{
+	r32 v0[3][STATIC_WORLD_LANES];
+	r32 v1[3][STATIC_WORLD_LANES];
+	r32 v2[3][STATIC_WORLD_LANES];
+	r32 normal[3][STATIC_WORLD_LANES]; // not normalized; zero in unused lanes so they never hit
+	r32 d[STATIC_WORLD_LANES];
+	r32 edge_tolerance[STATIC_WORLD_LANES];
+	s32 object[STATIC_WORLD_LANES];
+	s32 triangle[STATIC_WORLD_LANES];
+};
+
+struct BuildTriangle
+{
+	Vec3 vertices[3];
+	Vec3 centroid;
+	s32 object;
+	s32 index;
+};
+
+struct State
+{
+	Array<Node> nodes;
+	Array<Packet> packets;
+	Array<const btCollisionObject*> objects;
+	s16 groups_outside; // collision groups of bodies that aren't members
+	s32 depth; // of the deepest leaf
+	u32 revision;
+	b8 dirty;
+};
+State state;
+
+void bounds_add(Vec3* bmin, Vec3* bmax, const Vec3& p)
+{
+	*bmin = Vec3(vi_min(bmin->x, p.x), vi_min(bmin->y, p.y), vi_min(bmin->z, p.z));
+	*bmax = Vec3(vi_max(bmax->x, p.x), vi_max(bmax->y, p.y), vi_max(bmax->z, p.z));
+}
+
+void packet_build(Packet* p, const BuildTriangle* tris, s32 count)
+{
+	memset(p, 0, sizeof(*p));
+	for (s32 k = 0; k < STATIC_WORLD_LANES; k++)
+	{
+		if (k < count)
+		{
+			const BuildTriangle& t = tris[k];
+			Vec3 normal = (t.vertices[1] - t.vertices[0]).cross(t.vertices[2] - t.vertices[0]);
+			for (s32 axis = 0; axis < 3; axis++)
+			{
+				p->v0[axis][k] = t.vertices[0][axis];
+				p->v1[axis][k] = t.vertices[1][axis];
+				p->v2[axis][k] = t.vertices[2][axis];
+				p->normal[axis][k] = normal[axis];
+			}
+			p->d[k] = normal.dot(t.vertices[0]);
+			p->edge_tolerance[k] = normal.length_squared() * -0.0001f; // same as btTriangleRaycastCallback
+			p->object[k] = t.object;
+			p->triangle[k] = t.index;
+		}
+		else
+			p->object[k] = -1;
+	}
+}
+
+s32 node_build(BuildTriangle* tris, s32 start, s32 end, s32 depth)
+{
+	state.depth = vi_max(state.depth, depth);
+	s32 index = state.nodes.length;
+	Node node;
+	node.bounds_min = Vec3(FLT_MAX);
+	node.bounds_max = Vec3(-FLT_MAX);
+	Vec3 centroid_min = Vec3(FLT_MAX);
+	Vec3 centroid_max = Vec3(-FLT_MAX);
+	for (s32 i = start; i < end; i++)
+	{
+		for (s32 j = 0; j < 3; j++)
+			bounds_add(&node.bounds_min, &node.bounds_max, tris[i].vertices[j]);
+		bounds_add(&centroid_min, &centroid_max, tris[i].centroid);
+	}
+	state.nodes.add(node);
+
+	if (end - start <= STATIC_WORLD_LANES)
+	{
+		state.nodes[index].offset = state.packets.length;
+		state.nodes[index].count = end - start;
+		packet_build(state.packets.add(), &tris[start], end - start);
+		return index;
+	}
+
+	// split at the middle of the longest axis
+	Vec3 extent = centroid_max - centroid_min;
+	s32 axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+	r32 middle = (centroid_min[axis] + centroid_max[axis]) * 0.5f;
+	s32 split = start;
+	for (s32 i = start; i < end; i++)
+	{
+		if (tris[i].centroid[axis] < middle)
+		{
+			BuildTriangle tmp = tris[i];
+			tris[i] = tris[split];
+			tris[split] = tmp;
+			split++;
+		}
+	}
+	if (split == start || split == end) // all centroids in one spot
+		split = (start + end) / 2;
+
+	node_build(tris, start, split, depth + 1);
+	s32 second = node_build(tris, split, end, depth + 1);
+	state.nodes[index].offset = second;
+	state.nodes[index].count = -axis;
+	return index;
+}
+
+void build()
+{
+	r64 timer = platform::time();
+
+	state.nodes.length = 0;
+	state.packets.length = 0;
+	state.objects.length = 0;
+	state.groups_outside = 0;
+	state.depth = 0;
+	state.revision++;
+	state.dirty = false;
+
+	Array<BuildTriangle> tris;
+	for (auto i = RigidBody::list.iterator(); !i.is_last(); i.next())
+	{
+		RigidBody* body = i.item();
+		if (!body->btBody)
+			continue;
+
+		if ((body->flags & RigidBody::FlagStaticWorld)
+			&& !(body->flags & RigidBody::FlagGhost)
+			&& body->type == RigidBody::Type::Mesh)
+		{
+			s32 object = state.objects.length;
+			state.objects.add(body->btBody);
+			body->btBody->setUserPointer(&state);
+
+			const Mesh* mesh = Loader::mesh(body->mesh_id);
+			const btTransform& transform = body->btBody->getWorldTransform();
+			for (s32 j = 0; j < mesh->indices.length; j += 3)
+			{
+				BuildTriangle* t = tris.add();
+				for (s32 k = 0; k < 3; k++)
+					t->vertices[k] = transform * btVector3(mesh->vertices[mesh->indices[j + k]]);
+				t->centroid = (t->vertices[0] + t->vertices[1] + t->vertices[2]) * (1.0f / 3.0f);
+				t->object = object;
+				t->index = j / 3;
+			}
+		}
+		else
+		{
+			body->btBody->setUserPointer(nullptr);
+			state.groups_outside |= body->collision_group;
+		}
+	}
+
+	if (tris.length > 0)
+		node_build(tris.data, 0, tris.length, 0);
+
+	if (state.depth + 1 > STATIC_WORLD_STACK)
+	{
+		// raycasts couldn't walk this tree without dropping nodes; leave the bodies to Bullet instead
+		vi_debug("Static world: tree depth %d is too deep. Falling back to Bullet.", state.depth);
+		for (s32 i = 0; i < state.objects.length; i++)
+		{
+			RigidBody* body = Entity::list[state.objects[i]->getUserIndex()].get<RigidBody>();
+			body->btBody->setUserPointer(nullptr);
+			state.groups_outside |= body->collision_group;
+		}
+		state.nodes.length = 0;
+		state.packets.length = 0;
+		state.objects.length = 0;
+		return;
+	}
+
+	vi_debug("Static world: %d triangles from %d bodies in %d nodes. %.1fms", tris.length, state.objects.length, state.nodes.length, (platform::time() - timer) * 1000.0);
+}
+
+void dirty()
+{
+	state.dirty = true;
+}
+
+void update()
+{
+	if (state.dirty)
+		build();
+}
+
+void track(s16 group)
+{
+	state.groups_outside |= group;
+}
+
+b8 member(const btCollisionObject* object)
+{
+	return object->getUserPointer() == &state;
+}
+
+b8 covers(s16 mask)
+{
+	return !state.dirty && !(state.groups_outside & mask);
+}
+
+u32 revision()
+{
+	return state.revision;
+}
+
+// same test as btTriangleRaycastCallback::processTriangle, on every lane at once
+void packet_raycast(const Packet& p, const Vec3& from, const Vec3& to, r32 max_fraction, b8 filter_backfaces, r32* distance, r32* side, b8* hit)
+{
+	for (s32 k = 0; k < STATIC_WORLD_LANES; k++)
+	{
+		r32 nx = p.normal[0][k];
+		r32 ny = p.normal[1][k];
+		r32 nz = p.normal[2][k];
+		r32 dist_a = nx * from.x + ny * from.y + nz * from.z - p.d[k];
+		r32 dist_b = nx * to.x + ny * to.y + nz * to.z - p.d[k];
+		r32 projection = dist_a - dist_b;
+		r32 t = dist_a / (projection == 0.0f ? 1.0f : projection);
+
+		r32 px = from.x + (to.x - from.x) * t;
+		r32 py = from.y + (to.y - from.y) * t;
+		r32 pz = from.z + (to.z - from.z) * t;
+
+		r32 ax = p.v0[0][k] - px, ay = p.v0[1][k] - py, az = p.v0[2][k] - pz;
+		r32 bx = p.v1[0][k] - px, by = p.v1[1][k] - py, bz = p.v1[2][k] - pz;
+		r32 cx = p.v2[0][k] - px, cy = p.v2[1][k] - py, cz = p.v2[2][k] - pz;
+
+		r32 e0 = (ay * bz - az * by) * nx + (az * bx - ax * bz) * ny + (ax * by - ay * bx) * nz;
+		r32 e1 = (by * cz - bz * cy) * nx + (bz * cx - bx * cz) * ny + (bx * cy - by * cx) * nz;
+		r32 e2 = (cy * az - cz * ay) * nx + (cz * ax - cx * az) * ny + (cx * ay - cy * ax) * nz;
+
+		r32 tolerance = p.edge_tolerance[k];
+		hit[k] = (dist_a * dist_b < 0.0f)
+			& (!filter_backfaces | (dist_a > 0.0f))
+			& (t < max_fraction)
+			& (e0 >= tolerance)
+			& (e1 >= tolerance)
+			& (e2 >= tolerance);
+		distance[k] = t;
+		side[k] = dist_a;
+	}
+}
+
+inline b8 node_raycast(const Node& node, const Vec3& from, const Vec3& dir_inverse, r32 max_fraction)
+{
+	r32 t_min = 0.0f;
+	r32 t_max = max_fraction;
+	for (s32 axis = 0; axis < 3; axis++)
+	{
+		r32 t1 = (node.bounds_min[axis] - from[axis]) * dir_inverse[axis];
+		r32 t2 = (node.bounds_max[axis] - from[axis]) * dir_inverse[axis];
+		t_min = vi_max(t_min, vi_min(t1, t2));
+		t_max = vi_min(t_max, vi_max(t1, t2));
+	}
+	return t_min <= t_max;
+}
+
+// tests the first count lanes of a packet and hands any hits to the callback
+void packet_report(const Packet& packet, s32 count, const Vec3& from, const Vec3& to, b8 filter_backfaces, b8 keep_normal, btCollisionWorld::RayResultCallback* callback)
+{
+	r32 distance[STATIC_WORLD_LANES];
+	r32 side[STATIC_WORLD_LANES];
+	b8 hit[STATIC_WORLD_LANES];
+	packet_raycast(packet, from, to, callback->m_closestHitFraction, filter_backfaces, distance, side, hit);
+	for (s32 k = 0; k < count; k++)
+	{
+		// lanes were tested against the closest fraction at the start of the packet
+		if (hit[k] && distance[k] < callback->m_closestHitFraction)
+		{
+			const btCollisionObject* object = state.objects[packet.object[k]];
+			if (!callback->needsCollision(object->getBroadphaseHandle()))
+				continue;
+
+			Vec3 normal = Vec3::normalize(Vec3(packet.normal[0][k], packet.normal[1][k], packet.normal[2][k]));
+			if (!keep_normal && side[k] <= 0.0f)
+				normal = -normal;
+
+			btCollisionWorld::LocalShapeInfo shape_info;
+			shape_info.m_shapePart = 0;
+			shape_info.m_triangleIndex = packet.triangle[k];
+			btCollisionWorld::LocalRayResult result(object, &shape_info, normal, distance[k]);
+			callback->addSingleResult(result, true);
+		}
+	}
+}
+
+void raycast(const Vec3& from, const Vec3& to, btCollisionWorld::RayResultCallback* callback)
+{
+	if (state.nodes.length == 0)
+		return;
+
+	Vec3 dir = to - from; // unnormalized, so node distances come out as ray fractions
+	Vec3 dir_inverse
+	(
+		dir.x == 0.0f ? BT_LARGE_FLOAT : 1.0f / dir.x,
+		dir.y == 0.0f ? BT_LARGE_FLOAT : 1.0f / dir.y,
+		dir.z == 0.0f ? BT_LARGE_FLOAT : 1.0f / dir.z
+	);
+	b8 filter_backfaces = callback->m_flags & btTriangleRaycastCallback::kF_FilterBackfaces;
+	b8 keep_normal = callback->m_flags & btTriangleRaycastCallback::kF_KeepUnflippedNormal;
+
+	s32 stack[STATIC_WORLD_STACK];
+	s32 stack_count = 0;
+	stack[stack_count++] = 0;
+	while (stack_count > 0)
+	{
+		const Node& node = state.nodes[stack[--stack_count]];
+		if (callback->m_closestHitFraction == 0.0f)
+			break;
+		if (!node_raycast(node, from, dir_inverse, callback->m_closestHitFraction))
+			continue;
+
+		if (node.count > 0)
+			packet_report(state.packets[node.offset], node.count, from, to, filter_backfaces, keep_normal, callback);
+		else
+		{
+			vi_assert(stack_count + 2 <= STATIC_WORLD_STACK); // build() guarantees this
+			// visit the near child first
+			s32 first = s32(&node - state.nodes.data) + 1;
+			if (dir[-node.count] < 0.0f)
+			{
+				stack[stack_count++] = first;
+				stack[stack_count++] = node.offset;
+			}
+			else
+			{
+				stack[stack_count++] = node.offset;
+				stack[stack_count++] = first;
+			}
+		}
+	}
+}
+
+s32 leaves(const Vec3& bmin, const Vec3& bmax, s32* out, s32 max)
+{
+	if (state.nodes.length == 0)
+		return 0;
+
+	s32 count = 0;
+	s32 stack[STATIC_WORLD_STACK];
+	s32 stack_count = 0;
+	stack[stack_count++] = 0;
+	while (stack_count > 0)
+	{
+		s32 index = stack[--stack_count];
+		const Node& node = state.nodes[index];
+		if (node.bounds_min.x > bmax.x || node.bounds_max.x < bmin.x
+			|| node.bounds_min.y > bmax.y || node.bounds_max.y < bmin.y
+			|| node.bounds_min.z > bmax.z || node.bounds_max.z < bmin.z)
+			continue;
+
+		if (node.count > 0)
+		{
+			if (count == max)
+				return -1;
+			out[count++] = index;
+		}
+		else
+		{
+			vi_assert(stack_count + 2 <= STATIC_WORLD_STACK); // build() guarantees this
+			stack[stack_count++] = node.offset;
+			stack[stack_count++] = index + 1;
+		}
+	}
+	return count;
+}
+
+void raycast_leaves(const s32* leaves, s32 count, const Vec3& from, const Vec3& to, btCollisionWorld::RayResultCallback* callback)
+{
+	b8 filter_backfaces = callback->m_flags & btTriangleRaycastCallback::kF_FilterBackfaces;
+	b8 keep_normal = callback->m_flags & btTriangleRaycastCallback::kF_KeepUnflippedNormal;
+	for (s32 i = 0; i < count; i++)
+	{
+		const Node& node = state.nodes[leaves[i]];
+		vi_assert(node.count > 0);
+		packet_report(state.packets[node.offset], node.count, from, to, filter_backfaces, keep_normal, callback);
+	}
+}
+
+}
+
+}
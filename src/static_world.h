@@ -0,0 +1,28 @@
+#pragma once
+#include "types.h"
+#include "lmath.h"
+#include <bullet/src/btBulletDynamicsCommon.h>
+
+namespace VI
+{
+
+// flattened BVH over the triangles of level geometry (rigid bodies flagged RigidBody::FlagStaticWorld).
+// raycasts test those triangles here, four at a time, and only walk Bullet's broadphase for everything else.
+// the bodies stay in the Bullet world; only queries skip them
+namespace StaticWorld
+{
+
+void build(); // update thread only
+void dirty(); // a member body came, went, or moved; rebuilt before the next query
+void update(); // rebuilds if dirty. call before querying
+void track(s16); // a body outside the static world was added with this collision group
+b8 member(const btCollisionObject*);
+b8 covers(s16); // true if nothing outside the static world can match this collision mask
+u32 revision(); // changes every time the static world is rebuilt
+void raycast(const Vec3&, const Vec3&, btCollisionWorld::RayResultCallback*); // reports hits to the callback like btCollisionWorld::rayTest. thread safe
+s32 leaves(const Vec3&, const Vec3&, s32*, s32); // leaves whose bounds overlap the box, or -1 if there are more than the given max. valid until the next rebuild. thread safe
+void raycast_leaves(const s32*, s32, const Vec3&, const Vec3&, btCollisionWorld::RayResultCallback*); // same as raycast, as long as the ray stays inside the box the leaves came from. thread safe
+
+}
+
+}
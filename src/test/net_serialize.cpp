@@ -0,0 +1,93 @@
+#include "net_serialize.h"
+#include <cstdio>
+
+using namespace VI;
+using namespace VI::Net;
+
+static u32 seed = 0x9e3779b9;
+
+static u8 noise()
+{
+	seed = seed * 1664525 + 1013904223;
+	return u8(seed >> 24);
+}
+
+// builds a finalized packet with the given number of incompressible payload bytes
+static void packet_build(StreamWrite* p, u8* payload, s32 payload_bytes)
+{
+	p->reset();
+	packet_init(p);
+	for (s32 i = 0; i < payload_bytes; i++)
+	{
+		payload[i] = noise();
+		p->bits(payload[i], 8);
+	}
+	packet_finalize(p);
+}
+
+// copies the packet into the receive buffer the same way a pooled PacketEntry gets filled by udp_receive
+static void packet_receive(StreamRead* in, const StreamWrite& p)
+{
+	in->reset();
+	s32 bytes = p.bytes_written();
+	memcpy(in->data.data, p.data.data, bytes);
+	in->resize_bytes(bytes);
+}
+
+static b8 packet_check(StreamRead* in, const u8* payload, s32 payload_bytes)
+{
+	if (!in->read_checksum())
+		return false;
+
+	StreamRead decompressed;
+	packet_decompress(in, &decompressed);
+	for (s32 i = 0; i < payload_bytes; i++)
+	{
+		u32 value;
+		decompressed.bits(value, 8);
+		if (value != payload[i])
+			return false;
+	}
+	return true;
+}
+
+s32 main(s32 argc, char** argv)
+{
+	StreamWrite p;
+	StreamRead in; // reused for every packet, like the receive pool
+	u8 payload[NET_MAX_PACKET_SIZE / 2];
+	s32 failures = 0;
+	s32 unaligned = 0;
+
+	for (s32 size = 1; size < 512; size++)
+	{
+		// a longer packet first, leaving junk in the buffer past the end of the next one
+		packet_build(&p, payload, sizeof(payload));
+		packet_receive(&in, p);
+		if (!packet_check(&in, payload, sizeof(payload)))
+		{
+			fprintf(stderr, "long packet failed checksum\n");
+			failures++;
+		}
+
+		packet_build(&p, payload, size);
+		if (p.bytes_written() % sizeof(u32) != 0)
+			unaligned++;
+		packet_receive(&in, p);
+		if (!packet_check(&in, payload, size))
+		{
+			fprintf(stderr, "%d-byte packet (%d bytes on the wire) failed after a longer packet\n", size, p.bytes_written());
+			failures++;
+		}
+	}
+
+	if (unaligned == 0)
+	{
+		fprintf(stderr, "no unaligned packets were generated\n");
+		failures++;
+	}
+
+	if (failures == 0)
+		fprintf(stderr, "net_serialize: ok\n");
+	return failures == 0 ? 0 : 1;
+}
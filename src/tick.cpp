@@ -0,0 +1,171 @@
+#include "tick.h"
+#include "vi_assert.h"
+#include "load.h"
+#include "data/json.h"
+#include "cjson/cJSON.h"
+#include <chrono>
+#include <thread>
+
+namespace VI
+{
+
+namespace Tick
+{
+
+#define TICK_SPIN_TIME 0.002 // sleep until this long before the deadline, then spin; OS sleeps can overshoot by a millisecond or more
+#define TICK_MAX_BEHIND 4 // if we fall more than this many ticks behind, skip ahead rather than trying to catch up
+
+typedef std::chrono::steady_clock Clock;
+
+struct State
+{
+	Clock::time_point deadline;
+	Clock::time_point tick_start;
+	Histogram duration;
+	Histogram lateness;
+	u64 skipped;
+	r32 last;
+	b8 started;
+};
+State state;
+
+void Histogram::add(u64 us)
+{
+	s32 bucket = 0;
+	u64 x = us + 1;
+	while (x > 1 && bucket < TICK_HISTOGRAM_BUCKETS - 1)
+	{
+		x >>= 1;
+		bucket++;
+	}
+	buckets[bucket]++;
+	count++;
+	total_us += us;
+	if (us > max_us)
+		max_us = us;
+}
+
+u64 Histogram::percentile(r32 p) const
+{
+	u64 target = u64(r64(count) * p);
+	u64 sum = 0;
+	for (s32 i = 0; i < TICK_HISTOGRAM_BUCKETS; i++)
+	{
+		sum += buckets[i];
+		if (sum > target)
+		{
+			u64 bound = (u64(1) << (i + 1)) - 1;
+			return bound < max_us ? bound : max_us;
+		}
+	}
+	return max_us;
+}
+
+u64 microseconds(Clock::duration d)
+{
+	return u64(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+}
+
+void wait(r32 interval)
+{
+	Clock::time_point now = Clock::now();
+
+	if (interval <= 0.0f || !state.started)
+	{
+		state.deadline = now;
+		state.started = true;
+	}
+	else
+	{
+		Clock::duration step = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<r64>(interval));
+		state.deadline += step;
+
+		if (now > state.deadline + step * TICK_MAX_BEHIND)
+		{
+			// too far behind; drop the missed ticks
+			state.skipped += u64((now - state.deadline) / step);
+			state.deadline = now;
+		}
+		else if (now < state.deadline)
+		{
+			Clock::duration spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<r64>(TICK_SPIN_TIME));
+			if (state.deadline - now > spin)
+				std::this_thread::sleep_until(state.deadline - spin);
+			while (Clock::now() < state.deadline)
+				std::this_thread::yield();
+		}
+		// else we're a little late; run immediately and catch up on the following ticks
+	}
+
+	state.tick_start = Clock::now();
+	state.lateness.add(microseconds(state.tick_start - state.deadline));
+}
+
+void done()
+{
+	u64 us = microseconds(Clock::now() - state.tick_start);
+	state.duration.add(us);
+	state.last = r32(r64(us) / 1000000.0);
+}
+
+const Histogram& duration()
+{
+	return state.duration;
+}
+
+const Histogram& lateness()
+{
+	return state.lateness;
+}
+
+u64 skipped()
+{
+	return state.skipped;
+}
+
+r32 last()
+{
+	return state.last;
+}
+
+cJSON* histogram_json(const Histogram& h)
+{
+	cJSON* json = cJSON_CreateObject();
+	cJSON_AddNumberToObject(json, "count", r64(h.count));
+	cJSON_AddNumberToObject(json, "mean_us", h.count > 0 ? r64(h.total_us) / r64(h.count) : 0.0);
+	cJSON_AddNumberToObject(json, "p50_us", r64(h.percentile(0.5f)));
+	cJSON_AddNumberToObject(json, "p99_us", r64(h.percentile(0.99f)));
+	cJSON_AddNumberToObject(json, "max_us", r64(h.max_us));
+	cJSON* buckets = cJSON_CreateArray();
+	for (s32 i = 0; i < TICK_HISTOGRAM_BUCKETS; i++)
+		cJSON_AddItemToArray(buckets, cJSON_CreateNumber(r64(h.buckets[i])));
+	cJSON_AddItemToObject(json, "buckets", buckets);
+	return json;
+}
+
+void dump(const char* filename)
+{
+	vi_debug("Ticks: %llu, skipped %llu. Duration p50 %lluus p99 %lluus max %lluus. Lateness p50 %lluus p99 %lluus max %lluus.",
+		(unsigned long long)state.duration.count,
+		(unsigned long long)state.skipped,
+		(unsigned long long)state.duration.percentile(0.5f),
+		(unsigned long long)state.duration.percentile(0.99f),
+		(unsigned long long)state.duration.max_us,
+		(unsigned long long)state.lateness.percentile(0.5f),
+		(unsigned long long)state.lateness.percentile(0.99f),
+		(unsigned long long)state.lateness.max_us);
+
+	cJSON* json = cJSON_CreateObject();
+	cJSON_AddNumberToObject(json, "skipped", r64(state.skipped));
+	cJSON_AddItemToObject(json, "duration", histogram_json(state.duration));
+	cJSON_AddItemToObject(json, "lateness", histogram_json(state.lateness));
+
+	char path[MAX_PATH_LENGTH + 1];
+	Loader::user_data_path(path, filename);
+	Json::save(json, path);
+	Json::json_free(json);
+}
+
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include "types.h"
+
+namespace VI
+{
+
+// schedules update ticks against absolute deadlines on a monotonic clock, so the tick rate doesn't drift,
+// and records how long ticks take and how late they start
+namespace Tick
+{
+
+#define TICK_HISTOGRAM_BUCKETS 24 // bucket i counts samples in [2^i - 1, 2^(i + 1) - 1) microseconds
+
+struct Histogram
+{
+	u64 buckets[TICK_HISTOGRAM_BUCKETS];
+	u64 count;
+	u64 total_us;
+	u64 max_us;
+
+	void add(u64);
+	u64 percentile(r32) const; // upper bound of the bucket containing the given percentile
+};
+
+// blocks until the next deadline. an interval of zero means run as fast as possible
+void wait(r32);
+// call once the tick's work is done
+void done();
+void dump(const char*);
+const Histogram& duration();
+const Histogram& lateness();
+u64 skipped();
+r32 last(); // duration of the most recent tick, in seconds
+
+}
+
+}